@@ -0,0 +1,479 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_duration.h"
+#include "posting_list.h"
+#include "search_server.h"
+#include "string_processing.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace {
+
+vector<vector<int>> GenerateCorpus(mt19937& generator, int document_count, int vocabulary_size, int max_word_count) {
+    vector<vector<int>> corpus(document_count);
+    uniform_int_distribution<int> word_count(1, max_word_count);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (auto& words : corpus) {
+        words.resize(word_count(generator));
+        for (int& word : words) {
+            // Квадрат равномерной величины даёт частые и редкие слова, как в реальном тексте
+            const double u = unit(generator);
+            word = static_cast<int>(u * u * (vocabulary_size - 1));
+        }
+    }
+    return corpus;
+}
+
+vector<int> ShuffledIds(mt19937& generator, int count) {
+    vector<int> ids(count);
+    iota(ids.begin(), ids.end(), 0);
+    shuffle(ids.begin(), ids.end(), generator);
+    return ids;
+}
+
+string JoinWords(const vector<int>& words) {
+    string text;
+    for (const int word : words) {
+        text += "w"s + to_string(word) + " "s;
+    }
+    return text;
+}
+
+template <typename Postings>
+vector<pair<int, double>> FindTop(const Postings& word_to_document_freqs, const vector<int>& query, size_t top_count) {
+    map<int, double> document_to_relevance;
+    for (const int word : query) {
+        for (const auto [document_id, term_freq] : word_to_document_freqs[word]) {
+            document_to_relevance[document_id] += term_freq;
+        }
+    }
+    vector<pair<int, double>> result(document_to_relevance.begin(), document_to_relevance.end());
+    const size_t count = min(top_count, result.size());
+    partial_sort(result.begin(), result.begin() + count, result.end(),
+                 [](const auto& lhs, const auto& rhs) {
+        return lhs.second > rhs.second;
+    });
+    result.resize(count);
+    return result;
+}
+
+// Прежний разбор через find и find_first_not_of, с которым сравнивается векторный
+vector<string_view> SplitIntoWordsViewFind(string_view str) {
+    vector<string_view> result;
+    int64_t pos = str.find_first_not_of(" ");
+    const int64_t pos_end = str.npos;
+    while (pos != pos_end) {
+        int64_t space = str.find(' ', pos);
+        result.push_back(space == pos_end ? str.substr(pos) : str.substr(pos, space - pos));
+        pos = str.find_first_not_of(" ", space);
+    }
+    return result;
+}
+
+template <typename Splitter>
+void MeasureTokenizer(ostream& out, const string& name, const vector<string>& documents, size_t text_size, Splitter split) {
+    const auto start_time = chrono::steady_clock::now();
+    size_t word_count = 0;
+    for (const string& document : documents) {
+        word_count += split(document).size();
+    }
+    const chrono::duration<double> seconds = chrono::steady_clock::now() - start_time;
+    out << name << ": "s << static_cast<int>(text_size / seconds.count() / (1 << 20)) << " MB/s, "s << word_count << " words"s << endl;
+}
+
+// Запросы из трёх слов близкой частоты с суммарной длиной списков около cost. Слова берутся по кругу
+// из первых query_count * 3 терминов нужной частоты, поэтому для частых слов запросы повторяются
+vector<string> MakeQueriesOfCost(const vector<TermStatistics>& terms, size_t cost, size_t query_count) {
+    const auto first = lower_bound(terms.begin(), terms.end(), cost / 3, [](const TermStatistics& term, size_t value) {
+        return static_cast<size_t>(term.document_freq) < value;
+    });
+    const size_t term_count = min<size_t>(terms.end() - first, query_count * 3);
+    vector<string> queries;
+    if (term_count < 3) {
+        return queries;
+    }
+    for (size_t i = 0; i < query_count; ++i) {
+        string query;
+        for (size_t word = 0; word < 3; ++word) {
+            query += string(first[(i * 3 + word) % term_count].term) + " "s;
+        }
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
+double MeasureStrategy(const SearchServer& search_server, ThreadPool& pool, ExecutionStrategy strategy, const vector<string>& queries) {
+    const AdaptivePolicy policy(pool, strategy);
+    const auto start_time = chrono::steady_clock::now();
+    for (const string& query : queries) {
+        search_server.FindTopDocuments(policy, query, [](int, DocumentStatus, int) { return true; });
+    }
+    const chrono::duration<double> seconds = chrono::steady_clock::now() - start_time;
+    return seconds.count();
+}
+
+template <typename Postings>
+double RunQueries(const Postings& word_to_document_freqs, const vector<vector<int>>& queries) {
+    double checksum = 0.0;
+    for (const auto& query : queries) {
+        for (const auto& [document_id, relevance] : FindTop(word_to_document_freqs, query, 5)) {
+            checksum += relevance;
+        }
+    }
+    return checksum;
+}
+
+}
+
+void BenchmarkPostingLists(ostream& out, int document_count, int vocabulary_size) {
+    mt19937 generator(42);
+    const auto corpus = GenerateCorpus(generator, document_count, vocabulary_size, 50);
+    const auto queries = GenerateCorpus(generator, 1000, vocabulary_size, 5);
+    const auto ids = ShuffledIds(generator, document_count);
+
+    vector<map<int, double>> map_postings(vocabulary_size);
+    vector<PostingList> compact_postings(vocabulary_size);
+    {
+        LOG_DURATION_STREAM("std::map ingestion"s, out);
+        for (const int id : ids) {
+            map<int, double> word_freqs;
+            for (const int word : corpus[id]) {
+                word_freqs[word] += 1.0 / corpus[id].size();
+            }
+            for (const auto [word, term_freq] : word_freqs) {
+                map_postings[word][id] = term_freq;
+            }
+        }
+    }
+    {
+        LOG_DURATION_STREAM("PostingList ingestion"s, out);
+        for (const int id : ids) {
+            map<int, double> word_freqs;
+            for (const int word : corpus[id]) {
+                word_freqs[word] += 1.0 / corpus[id].size();
+            }
+            for (const auto [word, term_freq] : word_freqs) {
+                compact_postings[word].Insert(id, term_freq);
+            }
+        }
+    }
+
+    double map_checksum, compact_checksum;
+    {
+        LOG_DURATION_STREAM("std::map top-5 queries"s, out);
+        map_checksum = RunQueries(map_postings, queries);
+    }
+    {
+        LOG_DURATION_STREAM("PostingList top-5 queries"s, out);
+        compact_checksum = RunQueries(compact_postings, queries);
+    }
+    if (map_checksum != compact_checksum) {
+        out << "Query results differ: "s << map_checksum << " vs "s << compact_checksum << endl;
+    }
+
+    size_t posting_count = 0;
+    size_t compact_bytes = 0;
+    for (const auto& postings : compact_postings) {
+        posting_count += postings.size();
+        compact_bytes += postings.GetMemoryUsage();
+    }
+    // Узел красно-чёрного дерева: цвет, три указателя и сама пара, без учёта накладных расходов аллокатора
+    const size_t map_node_bytes = 4 * sizeof(void*) + sizeof(pair<const int, double>);
+    const size_t map_bytes = vocabulary_size * sizeof(map<int, double>) + posting_count * map_node_bytes;
+    out << "Postings: "s << posting_count << endl;
+    out << "std::map bytes per posting: "s << static_cast<double>(map_bytes) / posting_count << endl;
+    out << "PostingList bytes per posting: "s << static_cast<double>(compact_bytes) / posting_count << endl;
+}
+
+void BenchmarkParallelScoring(ostream& out, int document_count, size_t max_thread_count) {
+    if (max_thread_count == 0) {
+        max_thread_count = max(1u, thread::hardware_concurrency());
+    }
+    const int vocabulary_size = 10000;
+    mt19937 generator(42);
+    const auto corpus = GenerateCorpus(generator, document_count, vocabulary_size, 50);
+    const auto queries = GenerateCorpus(generator, 200, vocabulary_size / 10, 5);
+
+    SearchServer search_server(""s);
+    for (int id = 0; id < document_count; ++id) {
+        search_server.AddDocument(id, JoinWords(corpus[id]), DocumentStatus::ACTUAL, {1});
+    }
+    vector<string> raw_queries;
+    for (const auto& query : queries) {
+        raw_queries.push_back(JoinWords(query));
+    }
+
+    for (size_t thread_count = 1; thread_count <= max_thread_count; ++thread_count) {
+        search_server.SetPartitionCount(thread_count);
+        ThreadPool pool(thread_count);
+        size_t result_count = 0;
+        {
+            LOG_DURATION_STREAM("Parallel scoring, "s + to_string(thread_count) + " threads"s, out);
+            for (const string& query : raw_queries) {
+                result_count += search_server.FindTopDocuments(ThreadPoolPolicy(pool), query).size();
+            }
+        }
+        if (result_count == 0) {
+            out << "No documents found"s << endl;
+        }
+    }
+}
+
+void BenchmarkDocumentRemoval(ostream& out, int document_count, double removed_share, int round_count) {
+    const int vocabulary_size = 10000;
+    mt19937 generator(42);
+    const auto corpus = GenerateCorpus(generator, document_count, vocabulary_size, 50);
+    const auto queries = GenerateCorpus(generator, 100, vocabulary_size, 3);
+    vector<string> texts;
+    for (const auto& words : corpus) {
+        texts.push_back(JoinWords(words));
+    }
+    vector<RawDocument> documents;
+    for (int id = 0; id < document_count; ++id) {
+        documents.push_back({id, texts[id], DocumentStatus::ACTUAL, {1}});
+    }
+
+    ThreadPool pool;
+    SearchServer single_server(""s);
+    SearchServer batch_server(""s);
+    single_server.AddDocuments(ThreadPoolPolicy(pool), documents);
+    batch_server.AddDocuments(ThreadPoolPolicy(pool), documents);
+
+    vector<int> alive_ids = ShuffledIds(generator, document_count);
+    for (int round = 0; round < round_count && !alive_ids.empty(); ++round) {
+        const size_t removed_count = min(alive_ids.size(), static_cast<size_t>(document_count * removed_share));
+        const vector<int> removed_ids(alive_ids.end() - removed_count, alive_ids.end());
+        alive_ids.resize(alive_ids.size() - removed_count);
+        {
+            LOG_DURATION_STREAM("RemoveDocument x "s + to_string(removed_count), out);
+            for (const int id : removed_ids) {
+                single_server.RemoveDocument(id);
+            }
+        }
+        {
+            LOG_DURATION_STREAM("RemoveDocuments("s + to_string(removed_count) + ")"s, out);
+            batch_server.RemoveDocuments(ThreadPoolPolicy(pool), removed_ids);
+        }
+
+        bool same = single_server.GetDocumentCount() == batch_server.GetDocumentCount()
+                && single_server.GetTermCount() == batch_server.GetTermCount();
+        for (const auto& query : queries) {
+            const auto single_documents = single_server.FindTopDocuments(JoinWords(query));
+            const auto batch_documents = batch_server.FindTopDocuments(JoinWords(query));
+            same = same && single_documents.size() == batch_documents.size()
+                    && equal(single_documents.begin(), single_documents.end(), batch_documents.begin(),
+                             [](const Document& lhs, const Document& rhs) {
+                return lhs.id == rhs.id && lhs.relevance == rhs.relevance;
+            });
+        }
+        if (!same) {
+            out << "Indexes differ after round "s << round + 1 << endl;
+        }
+    }
+}
+
+void BenchmarkPostingLayouts(ostream& out, int document_count, double actual_share) {
+    const int vocabulary_size = 10000;
+    mt19937 generator(42);
+    const auto corpus = GenerateCorpus(generator, document_count, vocabulary_size, 50);
+    vector<string> texts;
+    for (const auto& words : corpus) {
+        texts.push_back(JoinWords(words));
+    }
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    vector<RawDocument> documents;
+    for (int id = 0; id < document_count; ++id) {
+        const DocumentStatus status = unit(generator) < actual_share ? DocumentStatus::ACTUAL
+                                                                    : (unit(generator) < 0.5 ? DocumentStatus::BANNED : DocumentStatus::IRRELEVANT);
+        documents.push_back({id, texts[id], status, {1}});
+    }
+    // Запросы из одного слова проверяют ранний останов по влиянию, из нескольких — MaxScore по разделу
+    vector<vector<string>> query_sets(2);
+    for (const auto& words : GenerateCorpus(generator, 200, vocabulary_size / 10, 1)) {
+        query_sets[0].push_back(JoinWords({words.front()}));
+    }
+    for (const auto& words : GenerateCorpus(generator, 200, vocabulary_size / 10, 4)) {
+        query_sets[1].push_back(JoinWords(words));
+    }
+
+    SearchServer search_server(""s);
+    search_server.AddDocuments(documents);
+    vector<vector<vector<Document>>> expected(query_sets.size());
+    const vector<pair<PostingLayout, string>> layouts = {
+        {PostingLayout::ORDINAL, "ordinal"s},
+        {PostingLayout::STATUS_PARTITIONED, "status partitioned"s},
+        {PostingLayout::IMPACT_ORDERED, "impact ordered"s},
+    };
+    for (const auto& [layout, layout_name] : layouts) {
+        search_server.SetPostingLayout(layout);
+        for (size_t set = 0; set < query_sets.size(); ++set) {
+            vector<vector<Document>> results;
+            {
+                LOG_DURATION_STREAM("FindTopDocuments, "s + layout_name + (set == 0 ? ", single word"s : ", several words"s), out);
+                for (const string& query : query_sets[set]) {
+                    results.push_back(search_server.FindTopDocuments(query));
+                }
+            }
+            if (expected[set].empty()) {
+                expected[set] = move(results);
+                continue;
+            }
+            const bool same = equal(results.begin(), results.end(), expected[set].begin(),
+                                    [](const vector<Document>& lhs, const vector<Document>& rhs) {
+                return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& lhs, const Document& rhs) {
+                    return lhs.id == rhs.id && lhs.relevance == rhs.relevance;
+                });
+            });
+            if (!same) {
+                out << "Results differ for layout "s << layout_name << endl;
+            }
+        }
+    }
+}
+
+void BenchmarkTokenizer(ostream& out, size_t text_size) {
+    mt19937 generator(42);
+    vector<string> documents;
+    size_t total_size = 0;
+    while (total_size < text_size) {
+        for (const auto& words : GenerateCorpus(generator, 1000, 50000, 200)) {
+            documents.push_back(JoinWords(words));
+            total_size += documents.back().size();
+        }
+    }
+
+    MeasureTokenizer(out, "find + validation"s, documents, total_size, [](string_view text) {
+        auto words = SplitIntoWordsViewFind(text);
+        for (const string_view word : words) {
+            if (any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+                return vector<string_view>{};
+            }
+        }
+        return words;
+    });
+    const TokenizerIsa detected_isa = GetTokenizerIsa();
+    const pair<TokenizerIsa, string> isas[] = {
+        {TokenizerIsa::SCALAR, "scalar masks"s},
+        {TokenizerIsa::SSE2, "SSE2"s},
+        {TokenizerIsa::AVX2, "AVX2"s},
+    };
+    for (const auto& [isa, name] : isas) {
+        if (SetTokenizerIsa(isa)) {
+            MeasureTokenizer(out, name, documents, total_size, [](string_view text) {
+                optional<string_view> invalid_word;
+                return SplitIntoWordsView(text, invalid_word);
+            });
+        }
+    }
+    SetTokenizerIsa(detected_isa);
+}
+
+ExecutionThresholds CalibrateExecutionThresholds(const SearchServer& search_server, ThreadPool& pool, ostream& out) {
+    constexpr size_t query_count = 20;
+    auto terms = search_server.GetCorpusStatistics();
+    sort(terms.begin(), terms.end(), [](const TermStatistics& lhs, const TermStatistics& rhs) {
+        return lhs.document_freq < rhs.document_freq;
+    });
+
+    // Порог — наименьшая стоимость, начиная с которой стратегия быстрее предыдущей на всех следующих уровнях
+    ExecutionThresholds thresholds{numeric_limits<size_t>::max(), numeric_limits<size_t>::max()};
+    bool by_term_wins = false;
+    bool by_doc_range_wins = false;
+    for (size_t cost = 1 << 8; cost <= static_cast<size_t>(search_server.GetDocumentCount()) * 3; cost *= 2) {
+        const auto queries = MakeQueriesOfCost(terms, cost, query_count);
+        if (queries.size() < query_count) {
+            break;
+        }
+        const double sequential = MeasureStrategy(search_server, pool, ExecutionStrategy::SEQUENTIAL, queries);
+        const double by_term = MeasureStrategy(search_server, pool, ExecutionStrategy::PARALLEL_BY_TERM, queries);
+        const double by_doc_range = MeasureStrategy(search_server, pool, ExecutionStrategy::PARALLEL_BY_DOC_RANGE, queries);
+        out << "Cost "s << cost << ": sequential "s << sequential * 1000 << " ms, by term "s << by_term * 1000
+            << " ms, by doc range "s << by_doc_range * 1000 << " ms"s << endl;
+
+        if (by_term < sequential) {
+            if (!by_term_wins) {
+                thresholds.parallel_by_term = cost;
+            }
+            by_term_wins = true;
+        } else {
+            by_term_wins = false;
+            thresholds.parallel_by_term = numeric_limits<size_t>::max();
+        }
+        if (by_doc_range < min(by_term, sequential)) {
+            if (!by_doc_range_wins) {
+                thresholds.parallel_by_doc_range = cost;
+            }
+            by_doc_range_wins = true;
+        } else {
+            by_doc_range_wins = false;
+            thresholds.parallel_by_doc_range = numeric_limits<size_t>::max();
+        }
+    }
+    out << "Thresholds: "s;
+    PrintExecutionThresholds(out, thresholds);
+    out << endl;
+    return thresholds;
+}
+
+void PrintExecutionThresholds(ostream& out, const ExecutionThresholds& thresholds) {
+    const auto print = [&out](size_t threshold) {
+        if (threshold == numeric_limits<size_t>::max()) {
+            out << "never"s;
+        } else {
+            out << threshold;
+        }
+    };
+    out << "by term from "s;
+    print(thresholds.parallel_by_term);
+    out << ", by doc range from "s;
+    print(thresholds.parallel_by_doc_range);
+}
+
+ExecutionThresholds RunBenchmarks(ostream& out, int document_count) {
+    BenchmarkPostingLists(out, document_count);
+    BenchmarkParallelScoring(out, document_count);
+    BenchmarkDocumentRemoval(out, document_count);
+    BenchmarkPostingLayouts(out, document_count);
+    BenchmarkTokenizer(out);
+
+    mt19937 generator(42);
+    vector<string> texts;
+    for (const auto& words : GenerateCorpus(generator, document_count, 10000, 50)) {
+        texts.push_back(JoinWords(words));
+    }
+    vector<RawDocument> documents;
+    for (int id = 0; id < document_count; ++id) {
+        documents.push_back({id, texts[id], DocumentStatus::ACTUAL, {1}});
+    }
+    vector<string> queries;
+    for (const auto& words : GenerateCorpus(generator, 1000, 10000, 3)) {
+        queries.push_back(JoinWords(words));
+    }
+    ThreadPool pool;
+    SearchServer search_server(""s);
+    search_server.AddDocuments(ThreadPoolPolicy(pool), documents);
+
+    // Пороги по умолчанию и откалиброванные сравниваются на одних и тех же запросах с AdaptivePolicy
+    const auto run_queries = [&](const string& name) {
+        LOG_DURATION_STREAM("AdaptivePolicy, "s + name + " thresholds"s, out);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(AdaptivePolicy(pool), query);
+        }
+    };
+    run_queries("default"s);
+    const ExecutionThresholds thresholds = CalibrateExecutionThresholds(search_server, pool, out);
+    search_server.SetExecutionThresholds(thresholds);
+    run_queries("calibrated"s);
+    return thresholds;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <iostream>
+
+#include "execution_strategy.h"
+#include "search_server.h"
+
+void BenchmarkPostingLists(std::ostream& out = std::cerr, int document_count = 100000, int vocabulary_size = 10000);
+
+void BenchmarkParallelScoring(std::ostream& out = std::cerr, int document_count = 100000, size_t max_thread_count = 0);
+
+// Сравнивает удаление по одному документу с пакетным RemoveDocuments на пуле потоков и проверяет, что индексы совпали.
+// Читателей здесь нет, а проверку с читателями и разными политиками выполняет TestBatchRemovalMatchesSingleRemoval
+void BenchmarkDocumentRemoval(std::ostream& out = std::cerr, int document_count = 100000, double removed_share = 0.1, int round_count = 3);
+
+// Сравнивает поиск по статусу при разных PostingLayout на корпусе, где документы нужного статуса в меньшинстве,
+// и проверяет, что результаты не зависят от раскладки
+void BenchmarkPostingLayouts(std::ostream& out = std::cerr, int document_count = 100000, double actual_share = 0.3);
+
+void BenchmarkTokenizer(std::ostream& out = std::cerr, size_t text_size = 64 << 20);
+
+// Замеряет стратегии выполнения на запросах к самому индексу и возвращает пороги, при которых параллельные стратегии начинают выигрывать
+ExecutionThresholds CalibrateExecutionThresholds(const SearchServer& search_server, ThreadPool& pool, std::ostream& out = std::cerr);
+
+// Пороги в виде «by term from N, by doc range from M»; порог стратегии, которая нигде не выигрывает, выводится как never
+void PrintExecutionThresholds(std::ostream& out, const ExecutionThresholds& thresholds);
+
+// Запускает все замеры на корпусе из document_count документов, search-server --benchmark [document_count].
+// Возвращает пороги, откалиброванные на этом корпусе: их можно сохранить и передать в SearchServer::SetExecutionThresholds
+ExecutionThresholds RunBenchmarks(std::ostream& out = std::cerr, int document_count = 100000);
@@ -1,46 +1,56 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <map>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using namespace std::string_literals;
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class ConcurrentMap {
 private:
-    struct Bucket {
+    struct Shard {
         std::mutex mutex;
-        std::map<Key, Value> map;
+        std::unordered_map<Key, Value, Hash> map;
     };
 
 public:
-    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys");
-
     struct Access {
         std::lock_guard<std::mutex> guard;
         Value& ref_to_value;
 
-        Access(const Key& key, Bucket& bucket)
-            : guard(bucket.mutex)
-            , ref_to_value(bucket.map[key]) {
+        Access(const Key& key, Shard& shard)
+            : guard(shard.mutex)
+            , ref_to_value(shard.map[key]) {
         }
     };
 
-    explicit ConcurrentMap(size_t bucket_count)
-        : buckets_(bucket_count) {
+    explicit ConcurrentMap(size_t shard_count)
+        : shards_(shard_count == 0 ? 1 : shard_count) {
     }
 
     Access operator[](const Key& key) {
-        auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-        return {key, bucket};
+        return {key, GetShard(key)};
+    }
+
+    bool Erase(const Key& key) {
+        auto& shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        return shard.map.erase(key) > 0;
+    }
+
+    size_t GetShardCount() const {
+        return shards_.size();
     }
 
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
-        for (auto& [mutex, map] : buckets_) {
+        for (auto& [mutex, map] : shards_) {
             std::lock_guard g(mutex);
             result.insert(map.begin(), map.end());
         }
@@ -48,5 +58,12 @@ public:
     }
 
 private:
-    std::vector<Bucket> buckets_;
+    std::vector<Shard> shards_;
+    Hash hasher_;
+
+    Shard& GetShard(const Key& key) {
+        // Перемешиваем хеш, чтобы тождественный std::hash для целых не собирал соседние ключи в одном шарде
+        const uint64_t hash = static_cast<uint64_t>(hasher_(key)) * 0x9E3779B97F4A7C15ull;
+        return shards_[(hash >> 32) % shards_.size()];
+    }
 };
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <iostream>
 
@@ -25,4 +26,11 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+struct RawDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 void PrintDocument(const Document& document);
@@ -0,0 +1,192 @@
+#include "document_table.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+DocumentTable::DocumentTable(const int* document_ids, const DocumentStatus* statuses, const int* ratings, const Fingerprint* fingerprints,
+                             const DocumentIdEntry* id_index, const FingerprintEntry* fingerprint_index, size_t count)
+    : mapped_document_ids_(document_ids)
+    , mapped_statuses_(statuses)
+    , mapped_ratings_(ratings)
+    , mapped_fingerprints_(fingerprints)
+    , mapped_id_index_(id_index)
+    , mapped_fingerprint_index_(fingerprint_index)
+    , mapped_count_(count) {
+}
+
+int DocumentTable::Add(int document_id, DocumentStatus status, int rating, Fingerprint fingerprint) {
+    Detach();
+    const int ordinal = static_cast<int>(document_ids_.size());
+    document_ids_.push_back(document_id);
+    statuses_.push_back(status);
+    ratings_.push_back(rating);
+    fingerprints_.push_back(fingerprint);
+    id_to_ordinal_.emplace(document_id, ordinal);
+    sorted_ids_.insert(document_id);
+    fingerprint_to_document_ids_.emplace(fingerprint, document_id);
+    return ordinal;
+}
+
+void DocumentTable::Remove(int ordinal) {
+    Detach();
+    const int document_id = document_ids_.at(ordinal);
+    id_to_ordinal_.erase(document_id);
+    sorted_ids_.erase(document_id);
+    EraseFingerprint(document_id, fingerprints_[ordinal]);
+    document_ids_[ordinal] = removed_id_;
+}
+
+optional<int> DocumentTable::FindOrdinal(int document_id) const {
+    if (mapped_id_index_ != nullptr) {
+        const auto last = mapped_id_index_ + mapped_count_;
+        const auto it = lower_bound(mapped_id_index_, last, document_id, [](const DocumentIdEntry& entry, int document_id) {
+            return entry.document_id < document_id;
+        });
+        if (it == last || it->document_id != document_id) {
+            return nullopt;
+        }
+        return it->ordinal;
+    }
+    const auto it = id_to_ordinal_.find(document_id);
+    if (it == id_to_ordinal_.end()) {
+        return nullopt;
+    }
+    return it->second;
+}
+
+int DocumentTable::GetOrdinal(int document_id) const {
+    if (const auto ordinal = FindOrdinal(document_id)) {
+        return *ordinal;
+    }
+    throw out_of_range("Invalid document_id"s);
+}
+
+optional<int> DocumentTable::FindDocumentWithFingerprint(Fingerprint fingerprint, int excluded_document_id) const {
+    if (mapped_fingerprint_index_ != nullptr) {
+        // Документы с одним отпечатком лежат подряд по возрастанию идентификаторов
+        const auto last = mapped_fingerprint_index_ + mapped_count_;
+        auto it = lower_bound(mapped_fingerprint_index_, last, fingerprint, [](const FingerprintEntry& entry, const Fingerprint& fingerprint) {
+            return entry.fingerprint < fingerprint;
+        });
+        for (; it != last && it->fingerprint == fingerprint; ++it) {
+            if (it->document_id != excluded_document_id) {
+                return it->document_id;
+            }
+        }
+        return nullopt;
+    }
+    optional<int> result;
+    const auto [first, last] = fingerprint_to_document_ids_.equal_range(fingerprint);
+    for (auto it = first; it != last; ++it) {
+        if (it->second != excluded_document_id && (!result || it->second < *result)) {
+            result = it->second;
+        }
+    }
+    return result;
+}
+
+void DocumentTable::SetStatus(int ordinal, DocumentStatus status) {
+    Detach();
+    statuses_[ordinal] = status;
+}
+
+void DocumentTable::SetRating(int ordinal, int rating) {
+    Detach();
+    ratings_[ordinal] = rating;
+}
+
+void DocumentTable::SetFingerprint(int ordinal, Fingerprint fingerprint) {
+    Detach();
+    EraseFingerprint(document_ids_[ordinal], fingerprints_[ordinal]);
+    fingerprint_to_document_ids_.emplace(fingerprint, document_ids_[ordinal]);
+    fingerprints_[ordinal] = fingerprint;
+}
+
+DocumentTable::IdIterator DocumentTable::begin() const {
+    if (mapped_id_index_ != nullptr) {
+        return IdIterator(mapped_id_index_);
+    }
+    return IdIterator(sorted_ids_.begin());
+}
+
+DocumentTable::IdIterator DocumentTable::end() const {
+    if (mapped_id_index_ != nullptr) {
+        return IdIterator(mapped_id_index_ + mapped_count_);
+    }
+    return IdIterator(sorted_ids_.end());
+}
+
+size_t DocumentTable::size() const {
+    return mapped_document_ids_ != nullptr ? mapped_count_ : id_to_ordinal_.size();
+}
+
+size_t DocumentTable::GetOrdinalBound() const {
+    return mapped_document_ids_ != nullptr ? mapped_count_ : document_ids_.size();
+}
+
+bool DocumentTable::NeedsCompaction() const {
+    return document_ids_.size() >= min_compaction_size_ && id_to_ordinal_.size() * 2 < document_ids_.size();
+}
+
+vector<int> DocumentTable::Compact() {
+    Detach();
+    vector<int> new_ordinals(document_ids_.size(), removed_id_);
+    size_t live_count = 0;
+    for (size_t ordinal = 0; ordinal < document_ids_.size(); ++ordinal) {
+        if (document_ids_[ordinal] == removed_id_) {
+            continue;
+        }
+        new_ordinals[ordinal] = static_cast<int>(live_count);
+        document_ids_[live_count] = document_ids_[ordinal];
+        statuses_[live_count] = statuses_[ordinal];
+        ratings_[live_count] = ratings_[ordinal];
+        fingerprints_[live_count] = fingerprints_[ordinal];
+        id_to_ordinal_[document_ids_[live_count]] = static_cast<int>(live_count);
+        ++live_count;
+    }
+    document_ids_.resize(live_count);
+    statuses_.resize(live_count);
+    ratings_.resize(live_count);
+    fingerprints_.resize(live_count);
+    document_ids_.shrink_to_fit();
+    statuses_.shrink_to_fit();
+    ratings_.shrink_to_fit();
+    fingerprints_.shrink_to_fit();
+    return new_ordinals;
+}
+
+void DocumentTable::EraseFingerprint(int document_id, Fingerprint fingerprint) {
+    const auto [first, last] = fingerprint_to_document_ids_.equal_range(fingerprint);
+    for (auto it = first; it != last; ++it) {
+        if (it->second == document_id) {
+            fingerprint_to_document_ids_.erase(it);
+            return;
+        }
+    }
+}
+
+void DocumentTable::Detach() {
+    if (mapped_document_ids_ == nullptr) {
+        return;
+    }
+    document_ids_.assign(mapped_document_ids_, mapped_document_ids_ + mapped_count_);
+    statuses_.assign(mapped_statuses_, mapped_statuses_ + mapped_count_);
+    ratings_.assign(mapped_ratings_, mapped_ratings_ + mapped_count_);
+    fingerprints_.assign(mapped_fingerprints_, mapped_fingerprints_ + mapped_count_);
+    id_to_ordinal_.reserve(mapped_count_);
+    for (size_t i = 0; i < mapped_count_; ++i) {
+        id_to_ordinal_.emplace(mapped_id_index_[i].document_id, mapped_id_index_[i].ordinal);
+        sorted_ids_.insert(sorted_ids_.end(), mapped_id_index_[i].document_id);
+        fingerprint_to_document_ids_.emplace(mapped_fingerprint_index_[i].fingerprint, mapped_fingerprint_index_[i].document_id);
+    }
+    mapped_document_ids_ = nullptr;
+    mapped_statuses_ = nullptr;
+    mapped_ratings_ = nullptr;
+    mapped_fingerprints_ = nullptr;
+    mapped_id_index_ = nullptr;
+    mapped_fingerprint_index_ = nullptr;
+    mapped_count_ = 0;
+}
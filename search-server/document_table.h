@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "fingerprint.h"
+
+// Записи упорядоченных индексов, которые хранятся в снимке и читаются прямо из отображённой памяти
+struct DocumentIdEntry {
+    int document_id;
+    int ordinal;
+};
+
+struct FingerprintEntry {
+    Fingerprint fingerprint;
+    int document_id;
+};
+
+class DocumentTable {
+public:
+    // Идентификаторы живых документов по возрастанию
+    class IdIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        IdIterator() = default;
+        explicit IdIterator(std::set<int>::const_iterator it)
+            : it_(it) {
+        }
+        explicit IdIterator(const DocumentIdEntry* entry)
+            : entry_(entry) {
+        }
+
+        reference operator*() const {
+            return entry_ != nullptr ? entry_->document_id : *it_;
+        }
+        pointer operator->() const {
+            return &**this;
+        }
+        IdIterator& operator++() {
+            if (entry_ != nullptr) {
+                ++entry_;
+            } else {
+                ++it_;
+            }
+            return *this;
+        }
+        IdIterator operator++(int) {
+            IdIterator result = *this;
+            ++*this;
+            return result;
+        }
+        bool operator==(const IdIterator& other) const {
+            return entry_ == other.entry_ && it_ == other.it_;
+        }
+        bool operator!=(const IdIterator& other) const {
+            return !(*this == other);
+        }
+    private:
+        std::set<int>::const_iterator it_;
+        const DocumentIdEntry* entry_ = nullptr;
+    };
+
+    DocumentTable() = default;
+    // Таблица ссылается на внешние массивы (например, на отображённый в память файл) и копирует их при первом изменении.
+    // Порядковые номера идут подряд от нуля, id_index упорядочен по идентификаторам,
+    // а fingerprint_index — по отпечаткам и при равных отпечатках по идентификаторам
+    DocumentTable(const int* document_ids, const DocumentStatus* statuses, const int* ratings, const Fingerprint* fingerprints,
+                  const DocumentIdEntry* id_index, const FingerprintEntry* fingerprint_index, size_t count);
+
+    int Add(int document_id, DocumentStatus status, int rating, Fingerprint fingerprint);
+    void Remove(int ordinal);
+
+    std::optional<int> FindOrdinal(int document_id) const;
+    int GetOrdinal(int document_id) const;
+    // Документ с наименьшим идентификатором и этим отпечатком, не считая excluded_document_id
+    std::optional<int> FindDocumentWithFingerprint(Fingerprint fingerprint, int excluded_document_id) const;
+
+    int GetDocumentId(int ordinal) const {
+        return mapped_document_ids_ != nullptr ? mapped_document_ids_[ordinal] : document_ids_[ordinal];
+    }
+    DocumentStatus GetStatus(int ordinal) const {
+        return mapped_statuses_ != nullptr ? mapped_statuses_[ordinal] : statuses_[ordinal];
+    }
+    int GetRating(int ordinal) const {
+        return mapped_ratings_ != nullptr ? mapped_ratings_[ordinal] : ratings_[ordinal];
+    }
+    Fingerprint GetFingerprint(int ordinal) const {
+        return mapped_fingerprints_ != nullptr ? mapped_fingerprints_[ordinal] : fingerprints_[ordinal];
+    }
+
+    void SetStatus(int ordinal, DocumentStatus status);
+    void SetRating(int ordinal, int rating);
+    void SetFingerprint(int ordinal, Fingerprint fingerprint);
+
+    IdIterator begin() const;
+    IdIterator end() const;
+
+    size_t size() const;
+    size_t GetOrdinalBound() const;
+
+    bool NeedsCompaction() const;
+    std::vector<int> Compact();
+private:
+    static constexpr int removed_id_ = -1;
+    static constexpr size_t min_compaction_size_ = 1024;
+
+    std::vector<int> document_ids_;
+    std::vector<DocumentStatus> statuses_;
+    std::vector<int> ratings_;
+    std::vector<Fingerprint> fingerprints_;
+    std::unordered_map<int, int> id_to_ordinal_;
+    std::set<int> sorted_ids_;
+    std::unordered_multimap<Fingerprint, int, FingerprintHasher> fingerprint_to_document_ids_;
+
+    const int* mapped_document_ids_ = nullptr;
+    const DocumentStatus* mapped_statuses_ = nullptr;
+    const int* mapped_ratings_ = nullptr;
+    const Fingerprint* mapped_fingerprints_ = nullptr;
+    const DocumentIdEntry* mapped_id_index_ = nullptr;
+    const FingerprintEntry* mapped_fingerprint_index_ = nullptr;
+    size_t mapped_count_ = 0;
+
+    void EraseFingerprint(int document_id, Fingerprint fingerprint);
+    void Detach();
+};
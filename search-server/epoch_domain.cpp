@@ -0,0 +1,111 @@
+#include "epoch_domain.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+EpochDomain::Guard::Guard(Slot* slot)
+    : slot_(slot) {
+}
+
+EpochDomain::Guard::Guard(Guard&& other) noexcept
+    : slot_(exchange(other.slot_, nullptr)) {
+}
+
+EpochDomain::Guard::~Guard() {
+    if (slot_) {
+        Unpin(*slot_);
+    }
+}
+
+EpochDomain::~EpochDomain() {
+    for (auto& [_, deleter] : retired_) {
+        deleter();
+    }
+    SlotBlock* block = first_block_.next.load();
+    while (block) {
+        delete exchange(block, block->next.load());
+    }
+}
+
+EpochDomain::Guard EpochDomain::Pin() {
+    const size_t first_slot = hash<thread::id>{}(this_thread::get_id()) % block_slot_count_;
+    SlotBlock* block = &first_block_;
+    while (true) {
+        for (size_t i = 0; i < block_slot_count_; ++i) {
+            Slot& slot = block->slots[(first_slot + i) % block_slot_count_];
+            bool expected = false;
+            if (!slot.in_use.load(memory_order_relaxed) && slot.in_use.compare_exchange_strong(expected, true, memory_order_acquire)) {
+                // Эпоха записывается до того, как читатель загрузит указатель на опубликованную версию
+                slot.epoch.store(global_epoch_.load());
+                return Guard(&slot);
+            }
+        }
+        SlotBlock* next = block->next.load();
+        if (!next) {
+            // Блок, добавленный другим потоком первым, используется вместо своего
+            auto new_block = make_unique<SlotBlock>();
+            if (block->next.compare_exchange_strong(next, new_block.get())) {
+                next = new_block.release();
+            }
+        }
+        block = next;
+    }
+}
+
+void EpochDomain::Retire(function<void()> deleter) {
+    // Версия снята с публикации до вызова, поэтому её могут видеть только читатели с эпохой не новее этой
+    const uint64_t retire_epoch = global_epoch_.fetch_add(1);
+    {
+        lock_guard lock(retired_mutex_);
+        retired_.push_back({retire_epoch, move(deleter)});
+    }
+    Collect();
+}
+
+void EpochDomain::Collect() {
+    vector<function<void()>> deleters;
+    {
+        lock_guard lock(retired_mutex_);
+        const uint64_t min_pinned_epoch = GetMinPinnedEpoch();
+        const auto reclaimable = stable_partition(retired_.begin(), retired_.end(), [min_pinned_epoch](const auto& retired) {
+            return retired.first >= min_pinned_epoch;
+        });
+        for (auto it = reclaimable; it != retired_.end(); ++it) {
+            deleters.push_back(move(it->second));
+        }
+        retired_.erase(reclaimable, retired_.end());
+    }
+    for (auto& deleter : deleters) {
+        deleter();
+    }
+}
+
+size_t EpochDomain::GetRetiredCount() const {
+    lock_guard lock(retired_mutex_);
+    return retired_.size();
+}
+
+size_t EpochDomain::GetSlotCount() const {
+    size_t slot_count = 0;
+    for (const SlotBlock* block = &first_block_; block; block = block->next.load()) {
+        slot_count += block_slot_count_;
+    }
+    return slot_count;
+}
+
+void EpochDomain::Unpin(Slot& slot) {
+    slot.epoch.store(idle_epoch_, memory_order_release);
+    slot.in_use.store(false, memory_order_release);
+}
+
+uint64_t EpochDomain::GetMinPinnedEpoch() const {
+    uint64_t min_epoch = idle_epoch_;
+    for (const SlotBlock* block = &first_block_; block; block = block->next.load()) {
+        for (const Slot& slot : block->slots) {
+            min_epoch = min(min_epoch, slot.epoch.load());
+        }
+    }
+    return min_epoch;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Эпохи для отложенного освобождения опубликованных версий: читатель закрепляет эпоху без мьютекса,
+// а писатель освобождает старую версию только после того, как её не может видеть ни один читатель
+class EpochDomain {
+    struct Slot;
+public:
+    class Guard {
+    public:
+        Guard(Guard&& other) noexcept;
+        Guard& operator=(Guard&&) = delete;
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard();
+    private:
+        friend class EpochDomain;
+        explicit Guard(Slot* slot);
+
+        Slot* slot_;
+    };
+
+    EpochDomain() = default;
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+    ~EpochDomain();
+
+    // Если все слоты заняты, например долгоживущими снимками, добавляется новый блок слотов, и Pin не ждёт освобождения
+    Guard Pin();
+
+    template <typename T>
+    void Retire(const T* object) {
+        Retire(std::function<void()>([object] {
+            delete object;
+        }));
+    }
+    void Retire(std::function<void()> deleter);
+    void Collect();
+
+    size_t GetRetiredCount() const;
+    size_t GetSlotCount() const;
+private:
+    static constexpr size_t block_slot_count_ = 128;
+    static constexpr uint64_t idle_epoch_ = std::numeric_limits<uint64_t>::max();
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch = idle_epoch_;
+        std::atomic<bool> in_use = false;
+    };
+    // Блоки только добавляются в конец списка и живут до разрушения домена, поэтому обходятся без блокировок
+    struct SlotBlock {
+        std::array<Slot, block_slot_count_> slots;
+        std::atomic<SlotBlock*> next = nullptr;
+    };
+
+    std::atomic<uint64_t> global_epoch_ = 1;
+    SlotBlock first_block_;
+    mutable std::mutex retired_mutex_;
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+
+    static void Unpin(Slot& slot);
+    uint64_t GetMinPinnedEpoch() const;
+};
@@ -0,0 +1,46 @@
+#include "execution_strategy.h"
+
+using namespace std;
+
+AdaptivePolicy::AdaptivePolicy()
+    : AdaptivePolicy(ThreadPool::GetDefault()) {
+}
+
+AdaptivePolicy::AdaptivePolicy(ThreadPool& pool)
+    : pool_(&pool) {
+}
+
+AdaptivePolicy::AdaptivePolicy(ThreadPool& pool, ExecutionStrategy strategy)
+    : pool_(&pool)
+    , strategy_(strategy) {
+}
+
+ThreadPool& AdaptivePolicy::GetPool() const {
+    return *pool_;
+}
+
+optional<ExecutionStrategy> AdaptivePolicy::GetStrategy() const {
+    return strategy_;
+}
+
+ExecutionStrategy ChooseExecutionStrategy(const ExecutionThresholds& thresholds, size_t cost, size_t max_term_cost) {
+    if (cost < thresholds.parallel_by_term && cost < thresholds.parallel_by_doc_range) {
+        return ExecutionStrategy::SEQUENTIAL;
+    }
+    if (cost < thresholds.parallel_by_doc_range && max_term_cost * 2 <= cost) {
+        return ExecutionStrategy::PARALLEL_BY_TERM;
+    }
+    return ExecutionStrategy::PARALLEL_BY_DOC_RANGE;
+}
+
+void ExecutionStrategyCounter::Record(ExecutionStrategy strategy) {
+    counts_[static_cast<size_t>(strategy)].fetch_add(1, memory_order_relaxed);
+}
+
+ExecutionStrategyStats ExecutionStrategyCounter::GetStats() const {
+    ExecutionStrategyStats stats;
+    stats.sequential = counts_[static_cast<size_t>(ExecutionStrategy::SEQUENTIAL)].load(memory_order_relaxed);
+    stats.parallel_by_term = counts_[static_cast<size_t>(ExecutionStrategy::PARALLEL_BY_TERM)].load(memory_order_relaxed);
+    stats.parallel_by_doc_range = counts_[static_cast<size_t>(ExecutionStrategy::PARALLEL_BY_DOC_RANGE)].load(memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "thread_pool.h"
+
+enum class ExecutionStrategy {
+    SEQUENTIAL,
+    PARALLEL_BY_TERM,
+    PARALLEL_BY_DOC_RANGE,
+};
+
+// Пороги оценённой стоимости запроса — суммарной длины списков документов его плюс-слов
+struct ExecutionThresholds {
+    size_t parallel_by_term = 1 << 15;
+    size_t parallel_by_doc_range = 1 << 17;
+};
+
+struct ExecutionStrategyStats {
+    uint64_t sequential = 0;
+    uint64_t parallel_by_term = 0;
+    uint64_t parallel_by_doc_range = 0;
+};
+
+// Политика выполнения, при которой SearchServer сам выбирает стратегию по длинам списков документов слов запроса.
+// Заданная явно стратегия применяется без оценки, это нужно для калибровки порогов
+class AdaptivePolicy {
+public:
+    AdaptivePolicy();
+    explicit AdaptivePolicy(ThreadPool& pool);
+    AdaptivePolicy(ThreadPool& pool, ExecutionStrategy strategy);
+
+    ThreadPool& GetPool() const;
+    std::optional<ExecutionStrategy> GetStrategy() const;
+private:
+    ThreadPool* pool_;
+    std::optional<ExecutionStrategy> strategy_;
+};
+
+// Разбиение по словам выгодно, только если ни одно слово не занимает больше половины стоимости запроса
+ExecutionStrategy ChooseExecutionStrategy(const ExecutionThresholds& thresholds, size_t cost, size_t max_term_cost);
+
+class ExecutionStrategyCounter {
+public:
+    void Record(ExecutionStrategy strategy);
+    ExecutionStrategyStats GetStats() const;
+private:
+    std::array<std::atomic<uint64_t>, 3> counts_{};
+};
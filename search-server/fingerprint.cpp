@@ -0,0 +1,50 @@
+#include "fingerprint.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+}
+
+bool operator==(const Fingerprint& lhs, const Fingerprint& rhs) {
+    return lhs.low == rhs.low && lhs.high == rhs.high;
+}
+
+bool operator!=(const Fingerprint& lhs, const Fingerprint& rhs) {
+    return !(lhs == rhs);
+}
+
+bool operator<(const Fingerprint& lhs, const Fingerprint& rhs) {
+    return tie(lhs.high, lhs.low) < tie(rhs.high, rhs.low);
+}
+
+void FingerprintBuilder::Add(string_view word) {
+    // Две независимые цепочки перемешивания по 8 байт: длина входит в начальное состояние, поэтому "ab" и "ab\0" различаются
+    uint64_t low = Mix(0x9e3779b97f4a7c15ULL ^ word.size());
+    uint64_t high = Mix(0xc2b2ae3d27d4eb4fULL + word.size());
+    for (size_t pos = 0; pos < word.size(); pos += sizeof(uint64_t)) {
+        uint64_t chunk = 0;
+        memcpy(&chunk, word.data() + pos, min(sizeof(uint64_t), word.size() - pos));
+        low = Mix(low ^ chunk);
+        high = Mix(high + chunk * 0xff51afd7ed558ccdULL);
+    }
+    fingerprint_.low += low;
+    fingerprint_.high += Mix(high ^ low);
+}
+
+Fingerprint FingerprintBuilder::Get() const {
+    return fingerprint_;
+}
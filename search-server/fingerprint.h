@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 128-битный отпечаток множества слов документа. Хэши слов складываются, поэтому отпечаток не зависит
+// от порядка добавления, но каждое слово должно добавляться один раз
+struct Fingerprint {
+    uint64_t low = 0;
+    uint64_t high = 0;
+};
+
+bool operator==(const Fingerprint& lhs, const Fingerprint& rhs);
+bool operator!=(const Fingerprint& lhs, const Fingerprint& rhs);
+bool operator<(const Fingerprint& lhs, const Fingerprint& rhs);
+
+struct FingerprintHasher {
+    size_t operator()(const Fingerprint& fingerprint) const {
+        return static_cast<size_t>(fingerprint.low);
+    }
+};
+
+class FingerprintBuilder {
+public:
+    void Add(std::string_view word);
+    Fingerprint Get() const;
+private:
+    Fingerprint fingerprint_;
+};
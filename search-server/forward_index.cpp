@@ -0,0 +1,80 @@
+#include "forward_index.h"
+
+using namespace std;
+
+ForwardIndex::ForwardIndex(const uint64_t* offsets, const TermFrequency* entries, size_t document_count)
+    : mapped_offsets_(offsets)
+    , mapped_entries_(entries)
+    , mapped_count_(document_count)
+    , mapped_cleared_(document_count, false) {
+}
+
+void ForwardIndex::Add(vector<TermFrequency> term_freqs) {
+    owned_.push_back(move(term_freqs));
+}
+
+void ForwardIndex::Clear(int ordinal) {
+    if (static_cast<size_t>(ordinal) < mapped_count_) {
+        mapped_cleared_[ordinal] = true;
+    } else {
+        vector<TermFrequency>().swap(owned_[ordinal - mapped_count_]);
+    }
+}
+
+void ForwardIndex::Set(int ordinal, vector<TermFrequency> term_freqs) {
+    Detach();
+    owned_[ordinal] = move(term_freqs);
+}
+
+void ForwardIndex::RemapDocuments(const vector<int>& new_ordinals, size_t ordinal_bound) {
+    vector<vector<TermFrequency>> owned(ordinal_bound);
+    for (size_t ordinal = 0; ordinal < new_ordinals.size(); ++ordinal) {
+        if (new_ordinals[ordinal] < 0) {
+            continue;
+        }
+        auto& target = owned[new_ordinals[ordinal]];
+        if (ordinal < mapped_count_) {
+            const Range range = Get(static_cast<int>(ordinal));
+            target.assign(range.begin(), range.end());
+        } else {
+            target = move(owned_[ordinal - mapped_count_]);
+        }
+    }
+    owned_.swap(owned);
+    mapped_offsets_ = nullptr;
+    mapped_entries_ = nullptr;
+    mapped_count_ = 0;
+    mapped_cleared_.clear();
+}
+
+ForwardIndex::Range ForwardIndex::Get(int ordinal) const {
+    if (static_cast<size_t>(ordinal) < mapped_count_) {
+        if (mapped_cleared_[ordinal]) {
+            return {nullptr, nullptr};
+        }
+        return {mapped_entries_ + mapped_offsets_[ordinal], mapped_entries_ + mapped_offsets_[ordinal + 1]};
+    }
+    const auto& term_freqs = owned_[ordinal - mapped_count_];
+    return {term_freqs.data(), term_freqs.data() + term_freqs.size()};
+}
+
+size_t ForwardIndex::size() const {
+    return mapped_count_ + owned_.size();
+}
+
+void ForwardIndex::Detach() {
+    if (mapped_count_ == 0) {
+        return;
+    }
+    vector<vector<TermFrequency>> owned(mapped_count_ + owned_.size());
+    for (size_t ordinal = 0; ordinal < mapped_count_; ++ordinal) {
+        const Range range = Get(static_cast<int>(ordinal));
+        owned[ordinal].assign(range.begin(), range.end());
+    }
+    move(owned_.begin(), owned_.end(), owned.begin() + mapped_count_);
+    owned_.swap(owned);
+    mapped_offsets_ = nullptr;
+    mapped_entries_ = nullptr;
+    mapped_count_ = 0;
+    mapped_cleared_.clear();
+}
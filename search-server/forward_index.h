@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct TermFrequency {
+    int term_id;
+    double term_freq;
+};
+
+class ForwardIndex {
+public:
+    class Range {
+    public:
+        Range(const TermFrequency* first, const TermFrequency* last)
+            : first_(first)
+            , last_(last) {
+        }
+
+        const TermFrequency* begin() const {
+            return first_;
+        }
+        const TermFrequency* end() const {
+            return last_;
+        }
+        size_t size() const {
+            return last_ - first_;
+        }
+        bool empty() const {
+            return first_ == last_;
+        }
+    private:
+        const TermFrequency* first_;
+        const TermFrequency* last_;
+    };
+
+    ForwardIndex() = default;
+    // Индекс ссылается на внешние массивы (например, на отображённый в память файл)
+    ForwardIndex(const uint64_t* offsets, const TermFrequency* entries, size_t document_count);
+
+    void Add(std::vector<TermFrequency> term_freqs);
+    void Clear(int ordinal);
+    void Set(int ordinal, std::vector<TermFrequency> term_freqs);
+    void RemapDocuments(const std::vector<int>& new_ordinals, size_t ordinal_bound);
+
+    Range Get(int ordinal) const;
+    size_t size() const;
+private:
+    const uint64_t* mapped_offsets_ = nullptr;
+    const TermFrequency* mapped_entries_ = nullptr;
+    size_t mapped_count_ = 0;
+    std::vector<bool> mapped_cleared_;
+    std::vector<std::vector<TermFrequency>> owned_;
+
+    void Detach();
+};
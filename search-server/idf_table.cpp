@@ -0,0 +1,41 @@
+#include "idf_table.h"
+
+#include <cmath>
+
+using namespace std;
+
+double IdfTable::Get(int term_id, uint64_t generation, int document_count, const vector<PostingList>& postings) const {
+    if (generation_.load(memory_order_acquire) == generation) {
+        return inverse_document_freqs_[term_id];
+    }
+    // Полный пересчёт стоит не больше, чем уже сделанные прямые вычисления
+    if (stale_lookups_.fetch_add(1, memory_order_relaxed) + 1 >= postings.size()) {
+        Refresh(generation, document_count, postings);
+        return inverse_document_freqs_[term_id];
+    }
+    return Compute(document_count, postings[term_id].size());
+}
+
+void IdfTable::Refresh(uint64_t generation, int document_count, const vector<PostingList>& postings) const {
+    lock_guard lock(refresh_mutex_);
+    if (generation_.load(memory_order_relaxed) == generation) {
+        return;
+    }
+    // Пока поколение не совпадает, читатели не обращаются к таблице, поэтому её можно переписать
+    inverse_document_freqs_.resize(postings.size());
+    for (size_t term_id = 0; term_id < postings.size(); ++term_id) {
+        inverse_document_freqs_[term_id] = Compute(document_count, postings[term_id].size());
+    }
+    stale_lookups_.store(0, memory_order_relaxed);
+    generation_.store(generation, memory_order_release);
+}
+
+void IdfTable::Carry(uint64_t from_generation, uint64_t to_generation) const {
+    lock_guard lock(refresh_mutex_);
+    uint64_t expected = from_generation;
+    generation_.compare_exchange_strong(expected, to_generation, memory_order_acq_rel);
+}
+
+double IdfTable::Compute(int document_count, size_t document_freq) {
+    return log(document_count * 1.0 / document_freq);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "posting_list.h"
+
+struct TermStatistics {
+    std::string_view term;
+    int document_freq = 0;
+    double inverse_document_freq = 0.0;
+};
+
+// IDF всех терминов для одного поколения индекса. После изменения индекса значения считаются по формуле
+// напрямую, а таблица пересчитывается целиком, когда таких прямых вычислений наберётся столько же, сколько терминов
+class IdfTable {
+public:
+    double Get(int term_id, uint64_t generation, int document_count, const std::vector<PostingList>& postings) const;
+    void Refresh(uint64_t generation, int document_count, const std::vector<PostingList>& postings) const;
+    // Переносит таблицу на новое поколение, если изменение индекса не затронуло частоты слов и число документов
+    void Carry(uint64_t from_generation, uint64_t to_generation) const;
+
+    static double Compute(int document_count, size_t document_freq);
+private:
+    static constexpr uint64_t no_generation_ = std::numeric_limits<uint64_t>::max();
+
+    mutable std::mutex refresh_mutex_;
+    mutable std::vector<double> inverse_document_freqs_;
+    mutable std::atomic<uint64_t> generation_ = no_generation_;
+    mutable std::atomic<size_t> stale_lookups_ = 0;
+};
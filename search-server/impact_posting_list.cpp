@@ -0,0 +1,184 @@
+#include "impact_posting_list.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ImpactPostingList::const_iterator::const_iterator(const ImpactPostingList* list, size_t base_pos, size_t insert_pos, size_t delete_pos)
+    : list_(list)
+    , base_pos_(base_pos)
+    , insert_pos_(insert_pos)
+    , delete_pos_(delete_pos) {
+    SkipDeleted();
+}
+
+ImpactPostingList::const_iterator::reference ImpactPostingList::const_iterator::operator*() const {
+    if (IsBaseCurrent()) {
+        return list_->postings_[base_pos_];
+    }
+    return list_->inserted_[insert_pos_];
+}
+
+ImpactPostingList::const_iterator& ImpactPostingList::const_iterator::operator++() {
+    if (IsBaseCurrent()) {
+        ++base_pos_;
+    } else {
+        ++insert_pos_;
+    }
+    SkipDeleted();
+    return *this;
+}
+
+ImpactPostingList::const_iterator ImpactPostingList::const_iterator::operator++(int) {
+    auto result = *this;
+    ++*this;
+    return result;
+}
+
+bool ImpactPostingList::const_iterator::operator==(const const_iterator& other) const {
+    return list_ == other.list_ && base_pos_ == other.base_pos_ && insert_pos_ == other.insert_pos_;
+}
+
+bool ImpactPostingList::const_iterator::operator!=(const const_iterator& other) const {
+    return !(*this == other);
+}
+
+bool ImpactPostingList::const_iterator::IsBaseCurrent() const {
+    if (base_pos_ == list_->postings_.size()) {
+        return false;
+    }
+    return insert_pos_ == list_->inserted_.size()
+            || IsMoreImpactful(list_->postings_[base_pos_], list_->inserted_[insert_pos_]);
+}
+
+void ImpactPostingList::const_iterator::SkipDeleted() {
+    const auto& postings = list_->postings_;
+    const auto& deleted = list_->deleted_;
+    while (base_pos_ < postings.size() && delete_pos_ < deleted.size()) {
+        if (IsMoreImpactful(deleted[delete_pos_], postings[base_pos_])) {
+            ++delete_pos_;
+        } else if (deleted[delete_pos_] == postings[base_pos_]) {
+            ++delete_pos_;
+            ++base_pos_;
+        } else {
+            break;
+        }
+    }
+}
+
+void ImpactPostingList::Insert(int ordinal, double term_freq) {
+    const Posting posting{ordinal, term_freq};
+    if (inserted_.empty() && (postings_.empty() || IsMoreImpactful(postings_.back(), posting))) {
+        postings_.push_back(posting);
+        return;
+    }
+    const auto deleted_it = lower_bound(deleted_.begin(), deleted_.end(), posting, IsMoreImpactful);
+    if (deleted_it != deleted_.end() && *deleted_it == posting) {
+        deleted_.erase(deleted_it);
+        return;
+    }
+    const auto it = lower_bound(inserted_.begin(), inserted_.end(), posting, IsMoreImpactful);
+    if (it == inserted_.end() || *it != posting) {
+        inserted_.insert(it, posting);
+        MergeIfNeeded();
+    }
+}
+
+void ImpactPostingList::Insert(vector<Posting> postings) {
+    if (postings.size() * buffer_ratio_ < size()) {
+        for (const auto& [ordinal, term_freq] : postings) {
+            Insert(ordinal, term_freq);
+        }
+        return;
+    }
+    sort(postings.begin(), postings.end(), IsMoreImpactful);
+    vector<Posting> merged;
+    merged.reserve(size() + postings.size());
+    merge(begin(), end(), postings.begin(), postings.end(), back_inserter(merged), IsMoreImpactful);
+    postings_.swap(merged);
+    inserted_.clear();
+    deleted_.clear();
+}
+
+bool ImpactPostingList::Erase(int ordinal, double term_freq) {
+    const Posting posting{ordinal, term_freq};
+    const auto it = lower_bound(inserted_.begin(), inserted_.end(), posting, IsMoreImpactful);
+    if (it != inserted_.end() && *it == posting) {
+        inserted_.erase(it);
+        return true;
+    }
+    const auto base_it = lower_bound(postings_.begin(), postings_.end(), posting, IsMoreImpactful);
+    if (base_it == postings_.end() || *base_it != posting) {
+        return false;
+    }
+    const auto deleted_it = lower_bound(deleted_.begin(), deleted_.end(), posting, IsMoreImpactful);
+    if (deleted_it != deleted_.end() && *deleted_it == posting) {
+        return false;
+    }
+    if (postings_.back() == posting && deleted_it == deleted_.end()) {
+        postings_.pop_back();
+        return true;
+    }
+    deleted_.insert(deleted_it, posting);
+    MergeIfNeeded();
+    return true;
+}
+
+void ImpactPostingList::Erase(const vector<int>& ordinals) {
+    vector<Posting> kept;
+    kept.reserve(size());
+    for (const Posting& posting : *this) {
+        if (!binary_search(ordinals.begin(), ordinals.end(), posting.first)) {
+            kept.push_back(posting);
+        }
+    }
+    postings_.swap(kept);
+    inserted_.clear();
+    deleted_.clear();
+}
+
+void ImpactPostingList::Merge() {
+    if (inserted_.empty() && deleted_.empty()) {
+        return;
+    }
+    vector<Posting> postings(begin(), end());
+    postings_.swap(postings);
+    inserted_.clear();
+    deleted_.clear();
+}
+
+void ImpactPostingList::RemapDocuments(const vector<int>& new_ordinals) {
+    Merge();
+    for (auto& [ordinal, _] : postings_) {
+        ordinal = new_ordinals[ordinal];
+    }
+}
+
+size_t ImpactPostingList::size() const {
+    return postings_.size() - deleted_.size() + inserted_.size();
+}
+
+bool ImpactPostingList::empty() const {
+    return size() == 0;
+}
+
+ImpactPostingList::const_iterator ImpactPostingList::begin() const {
+    return {this, 0, 0, 0};
+}
+
+ImpactPostingList::const_iterator ImpactPostingList::end() const {
+    return {this, postings_.size(), inserted_.size(), deleted_.size()};
+}
+
+void ImpactPostingList::MergeIfNeeded() {
+    if (inserted_.size() + deleted_.size() > max(min_buffer_size_, postings_.size() / buffer_ratio_)) {
+        Merge();
+    }
+}
+
+bool ImpactPostingList::IsMoreImpactful(const Posting& lhs, const Posting& rhs) {
+    if (lhs.second != rhs.second) {
+        return lhs.second > rhs.second;
+    }
+    return lhs.first < rhs.first;
+}
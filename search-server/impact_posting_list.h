@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// Список документов слова по убыванию частоты, при равной частоте по возрастанию порядковых номеров.
+// Одиночные изменения копятся в небольших буферах и сливаются с основным массивом пачкой, как в PostingList
+class ImpactPostingList {
+public:
+    using Posting = std::pair<int, double>;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Posting;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+        const_iterator(const ImpactPostingList* list, size_t base_pos, size_t insert_pos, size_t delete_pos);
+
+        reference operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+    private:
+        const ImpactPostingList* list_ = nullptr;
+        size_t base_pos_ = 0;
+        size_t insert_pos_ = 0;
+        size_t delete_pos_ = 0;
+
+        bool IsBaseCurrent() const;
+        void SkipDeleted();
+    };
+
+    void Insert(int ordinal, double term_freq);
+    // Пакет в произвольном порядке: небольшой уходит в буфер, большой сортируется и сливается за O(n + k log k)
+    void Insert(std::vector<Posting> postings);
+    bool Erase(int ordinal, double term_freq);
+    // Удаляет документы из отсортированного по возрастанию списка порядковых номеров
+    void Erase(const std::vector<int>& ordinals);
+    void Merge();
+    void RemapDocuments(const std::vector<int>& new_ordinals);
+
+    size_t size() const;
+    bool empty() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+private:
+    static constexpr size_t min_buffer_size_ = 32;
+    static constexpr size_t buffer_ratio_ = 16;
+
+    std::vector<Posting> postings_;
+    std::vector<Posting> inserted_;
+    std::vector<Posting> deleted_;
+
+    void MergeIfNeeded();
+
+    static bool IsMoreImpactful(const Posting& lhs, const Posting& rhs);
+};
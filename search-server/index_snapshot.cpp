@@ -0,0 +1,201 @@
+#include "index_snapshot.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+const size_t SNAPSHOT_ALIGNMENT = 8;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t UpdateChecksum(uint64_t checksum, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        checksum ^= static_cast<unsigned char>(data[i]);
+        checksum *= FNV_PRIME;
+    }
+    return checksum;
+}
+
+}
+
+MappedFile::MappedFile(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Cannot open snapshot "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw runtime_error("Cannot stat snapshot "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("Cannot map snapshot "s + path);
+        }
+        data_ = static_cast<const char*>(address);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+const char* MappedFile::data() const {
+    return data_;
+}
+
+size_t MappedFile::size() const {
+    return size_;
+}
+
+SnapshotWriter::SnapshotWriter(const string& path)
+    : path_(path)
+    , out_(path, ios::binary | ios::trunc)
+    , checksum_(FNV_OFFSET_BASIS) {
+    if (!out_) {
+        throw runtime_error("Cannot create snapshot "s + path);
+    }
+    const SnapshotHeader placeholder{};
+    out_.write(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder));
+}
+
+void SnapshotWriter::WriteStrings(const vector<string_view>& strings) {
+    WriteValue<uint64_t>(strings.size());
+    vector<uint64_t> offsets(strings.size() + 1, 0);
+    for (size_t i = 0; i < strings.size(); ++i) {
+        offsets[i + 1] = offsets[i] + strings[i].size();
+    }
+    WriteArray(offsets.data(), offsets.size());
+    Align();
+    for (const string_view str : strings) {
+        Write(str.data(), str.size());
+    }
+    Align();
+}
+
+void SnapshotWriter::Align() {
+    static const char padding[SNAPSHOT_ALIGNMENT] = {};
+    const size_t remainder = payload_size_ % SNAPSHOT_ALIGNMENT;
+    if (remainder != 0) {
+        Write(padding, SNAPSHOT_ALIGNMENT - remainder);
+    }
+}
+
+void SnapshotWriter::Finish() {
+    Align();
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(SnapshotHeader);
+    header.payload_size = payload_size_;
+    header.checksum = checksum_;
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.flush();
+    if (!out_) {
+        throw runtime_error("Cannot write snapshot "s + path_);
+    }
+}
+
+void SnapshotWriter::Write(const char* data, size_t size) {
+    out_.write(data, size);
+    checksum_ = UpdateChecksum(checksum_, data, size);
+    payload_size_ += size;
+}
+
+SnapshotReader::SnapshotReader(const MappedFile& file, SnapshotVerification verification)
+    : data_(file.data() + sizeof(SnapshotHeader))
+    , size_(0)
+    , pos_(0)
+    , verification_(verification) {
+    if (file.size() < sizeof(SnapshotHeader)) {
+        throw runtime_error("Snapshot is truncated"s);
+    }
+    SnapshotHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        throw runtime_error("File is not a search server snapshot"s);
+    }
+    if (header.version != SNAPSHOT_VERSION || header.header_size != sizeof(SnapshotHeader)) {
+        throw runtime_error("Unsupported snapshot version "s + to_string(header.version));
+    }
+    if (header.payload_size != file.size() - sizeof(SnapshotHeader)) {
+        throw runtime_error("Snapshot is truncated"s);
+    }
+    size_ = header.payload_size;
+    if (verification_ == SnapshotVerification::FULL && UpdateChecksum(FNV_OFFSET_BASIS, data_, size_) != header.checksum) {
+        throw runtime_error("Snapshot checksum mismatch"s);
+    }
+}
+
+SnapshotVerification SnapshotReader::GetVerification() const {
+    return verification_;
+}
+
+SnapshotStrings SnapshotReader::ReadStringArray() {
+    SnapshotStrings strings;
+    strings.count = ReadValue<uint64_t>();
+    if (strings.count > size_) {
+        throw runtime_error("Snapshot is corrupted"s);
+    }
+    strings.offsets = ReadArray<uint64_t>(strings.count + 1);
+    strings.chars = Read(strings.offsets[strings.count]);
+    if (verification_ == SnapshotVerification::FULL) {
+        CheckOffsets(strings.offsets, strings.count);
+    }
+    return strings;
+}
+
+vector<string_view> SnapshotReader::ReadStrings() {
+    const SnapshotStrings strings = ReadStringArray();
+    // Строк немного (стоп-слова), поэтому их смещения проверяются всегда
+    CheckOffsets(strings.offsets, strings.count);
+    vector<string_view> result;
+    result.reserve(strings.count);
+    for (size_t i = 0; i < strings.count; ++i) {
+        result.emplace_back(strings.chars + strings.offsets[i], strings.offsets[i + 1] - strings.offsets[i]);
+    }
+    return result;
+}
+
+void SnapshotReader::CheckOffsets(const uint64_t* offsets, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (offsets[i] > offsets[i + 1]) {
+            throw runtime_error("Snapshot is corrupted"s);
+        }
+    }
+}
+
+const char* SnapshotReader::Read(size_t size) {
+    if (size > size_ - pos_) {
+        throw runtime_error("Snapshot is corrupted"s);
+    }
+    const char* result = data_ + pos_;
+    pos_ += size;
+    pos_ = min(size_, (pos_ + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT);
+    return result;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+const uint32_t SNAPSHOT_VERSION = 3;
+
+enum class SnapshotVerification {
+    // Проверяются заголовок, размер файла и границы разделов: загрузка не читает файл целиком.
+    // Подходит для снимков, которые записал этот же процесс или сборка
+    HEADER,
+    // Дополнительно проверяются контрольная сумма всего файла и смещения внутри разделов
+    FULL,
+};
+
+// Массив строк снимка без копирования: смещения и символы остаются в отображённой памяти
+struct SnapshotStrings {
+    const uint64_t* offsets = nullptr;
+    const char* chars = nullptr;
+    size_t count = 0;
+};
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const;
+    size_t size() const;
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Все массивы файла выровнены на 8 байт, поэтому их можно читать прямо из отображённой памяти
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path);
+
+    template <typename T>
+    void WriteValue(const T& value);
+    template <typename T>
+    void WriteArray(const T* data, size_t count);
+    void WriteStrings(const std::vector<std::string_view>& strings);
+    void Align();
+
+    void Finish();
+private:
+    std::string path_;
+    std::ofstream out_;
+    uint64_t payload_size_ = 0;
+    uint64_t checksum_;
+
+    void Write(const char* data, size_t size);
+};
+
+class SnapshotReader {
+public:
+    SnapshotReader(const MappedFile& file, SnapshotVerification verification);
+
+    SnapshotVerification GetVerification() const;
+
+    template <typename T>
+    T ReadValue();
+    template <typename T>
+    const T* ReadArray(size_t count);
+    SnapshotStrings ReadStringArray();
+    std::vector<std::string_view> ReadStrings();
+
+    // Смещения массива из count элементов (count + 1 значение) не убывают, иначе бросает runtime_error
+    static void CheckOffsets(const uint64_t* offsets, size_t count);
+private:
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+    SnapshotVerification verification_;
+
+    const char* Read(size_t size);
+};
+
+template <typename T>
+void SnapshotWriter::WriteValue(const T& value) {
+    WriteArray(&value, 1);
+    Align();
+}
+
+template <typename T>
+void SnapshotWriter::WriteArray(const T* data, size_t count) {
+    Write(reinterpret_cast<const char*>(data), count * sizeof(T));
+}
+
+template <typename T>
+T SnapshotReader::ReadValue() {
+    return *ReadArray<T>(1);
+}
+
+template <typename T>
+const T* SnapshotReader::ReadArray(size_t count) {
+    return reinterpret_cast<const T*>(Read(count * sizeof(T)));
+}
@@ -0,0 +1,280 @@
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Histograms {
+    array<LatencyHistogram, SEARCH_STAGE_COUNT> stages;
+    array<LatencyHistogram, SEARCH_COUNTER_COUNT> counters;
+
+    void Merge(const Histograms& other) {
+        for (size_t stage = 0; stage < SEARCH_STAGE_COUNT; ++stage) {
+            stages[stage].Merge(other.stages[stage]);
+        }
+        for (size_t counter = 0; counter < SEARCH_COUNTER_COUNT; ++counter) {
+            counters[counter].Merge(other.counters[counter]);
+        }
+    }
+
+    void Reset() {
+        for (auto& histogram : stages) {
+            histogram.Reset();
+        }
+        for (auto& histogram : counters) {
+            histogram.Reset();
+        }
+    }
+};
+
+// Гистограммы живых потоков и накопленные гистограммы завершившихся. Мьютекс берётся только при запуске
+// и завершении потока и при снятии снимка, поэтому запись в гистограммы обходится без блокировок
+struct Registry {
+    mutex threads_mutex;
+    vector<Histograms*> threads;
+    Histograms finished_threads;
+};
+
+Registry& GetRegistry() {
+    // Реестр не уничтожается, чтобы потоки, завершающиеся после main, могли в нём отметиться
+    static Registry* registry = new Registry;
+    return *registry;
+}
+
+HistogramSummary Summarize(const LatencyHistogram& histogram) {
+    HistogramSummary summary;
+    summary.count = histogram.GetCount();
+    summary.mean = histogram.GetMean();
+    summary.p50 = histogram.GetValueAtQuantile(0.5);
+    summary.p90 = histogram.GetValueAtQuantile(0.9);
+    summary.p99 = histogram.GetValueAtQuantile(0.99);
+    summary.p999 = histogram.GetValueAtQuantile(0.999);
+    summary.max = histogram.GetMax();
+    return summary;
+}
+
+void PrintSummary(ostream& out, string_view name, string_view unit, const HistogramSummary& summary) {
+    out << name << ": count "s << summary.count << ", mean "s << summary.mean << unit
+        << ", p50 "s << summary.p50 << unit << ", p90 "s << summary.p90 << unit << ", p99 "s << summary.p99 << unit
+        << ", p99.9 "s << summary.p999 << unit << ", max "s << summary.max << unit << '\n';
+}
+
+#ifdef SEARCH_SERVER_INSTRUMENTATION
+
+struct ThreadState {
+    Histograms histograms;
+    int query_depth = 0;
+    array<uint64_t, SEARCH_STAGE_COUNT> stage_nanoseconds{};
+    array<bool, SEARCH_STAGE_COUNT> is_stage_used{};
+    array<uint64_t, SEARCH_COUNTER_COUNT> counts{};
+
+    ThreadState() {
+        Registry& registry = GetRegistry();
+        lock_guard lock(registry.threads_mutex);
+        registry.threads.push_back(&histograms);
+    }
+
+    ~ThreadState() {
+        Registry& registry = GetRegistry();
+        lock_guard lock(registry.threads_mutex);
+        registry.finished_threads.Merge(histograms);
+        registry.threads.erase(find(registry.threads.begin(), registry.threads.end(), &histograms));
+    }
+};
+
+thread_local ThreadState thread_state;
+
+#endif
+
+}  // namespace
+
+string_view GetSearchStageName(SearchStage stage) {
+    switch (stage) {
+    case SearchStage::PARSE:
+        return "parse"sv;
+    case SearchStage::POSTING_TRAVERSAL:
+        return "posting traversal"sv;
+    case SearchStage::PREDICATE:
+        return "predicate"sv;
+    case SearchStage::MINUS_WORDS:
+        return "minus words"sv;
+    default:
+        return "top-k"sv;
+    }
+}
+
+string_view GetSearchCounterName(SearchCounter counter) {
+    return counter == SearchCounter::POSTINGS_VISITED ? "postings visited"sv : "documents scored"sv;
+}
+
+size_t GetLogLinearBucket(uint64_t value, size_t sub_bucket_bits) {
+    const uint64_t sub_bucket_count = uint64_t(1) << sub_bucket_bits;
+    if (value < sub_bucket_count) {
+        return value;
+    }
+    size_t exponent = 63;
+    while ((value >> exponent) == 0) {
+        --exponent;
+    }
+    return sub_bucket_count * (exponent - sub_bucket_bits + 1) + ((value >> (exponent - sub_bucket_bits)) & (sub_bucket_count - 1));
+}
+
+uint64_t GetLogLinearBucketLowerBound(size_t bucket, size_t sub_bucket_bits) {
+    const size_t sub_bucket_count = size_t(1) << sub_bucket_bits;
+    if (bucket < sub_bucket_count) {
+        return bucket;
+    }
+    const size_t exponent = bucket / sub_bucket_count + sub_bucket_bits - 1;
+    return uint64_t(sub_bucket_count + bucket % sub_bucket_count) << (exponent - sub_bucket_bits);
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    // Единственный писатель: загрузка и запись вместо fetch_add не требуют блокировки шины
+    const auto increase = [](atomic<uint64_t>& counter, uint64_t delta) {
+        counter.store(counter.load(memory_order_relaxed) + delta, memory_order_relaxed);
+    };
+    increase(counts_[GetLogLinearBucket(value, sub_bucket_bits_)], 1);
+    increase(count_, 1);
+    increase(sum_, value);
+    if (value > max_.load(memory_order_relaxed)) {
+        max_.store(value, memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t bucket = 0; bucket < bucket_count_; ++bucket) {
+        counts_[bucket].fetch_add(other.counts_[bucket].load(memory_order_relaxed), memory_order_relaxed);
+    }
+    count_.fetch_add(other.count_.load(memory_order_relaxed), memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(memory_order_relaxed), memory_order_relaxed);
+    max_.store(max(max_.load(memory_order_relaxed), other.max_.load(memory_order_relaxed)), memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& count : counts_) {
+        count.store(0, memory_order_relaxed);
+    }
+    count_.store(0, memory_order_relaxed);
+    sum_.store(0, memory_order_relaxed);
+    max_.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    return max_.load(memory_order_relaxed);
+}
+
+double LatencyHistogram::GetMean() const {
+    const uint64_t count = GetCount();
+    return count > 0 ? static_cast<double>(sum_.load(memory_order_relaxed)) / count : 0.0;
+}
+
+uint64_t LatencyHistogram::GetValueAtQuantile(double quantile) const {
+    uint64_t total = 0;
+    for (const auto& count : counts_) {
+        total += count.load(memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const uint64_t rank = min(total, static_cast<uint64_t>(ceil(quantile * total)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < bucket_count_; ++bucket) {
+        seen += counts_[bucket].load(memory_order_relaxed);
+        if (seen >= max<uint64_t>(rank, 1)) {
+            return GetLogLinearBucketLowerBound(bucket, sub_bucket_bits_);
+        }
+    }
+    return GetMax();
+}
+
+InstrumentationSnapshot GetInstrumentationSnapshot() {
+    Histograms histograms;
+    {
+        Registry& registry = GetRegistry();
+        lock_guard lock(registry.threads_mutex);
+        histograms.Merge(registry.finished_threads);
+        for (const Histograms* thread_histograms : registry.threads) {
+            histograms.Merge(*thread_histograms);
+        }
+    }
+    InstrumentationSnapshot snapshot;
+    for (size_t stage = 0; stage < SEARCH_STAGE_COUNT; ++stage) {
+        snapshot.stages[stage] = Summarize(histograms.stages[stage]);
+    }
+    for (size_t counter = 0; counter < SEARCH_COUNTER_COUNT; ++counter) {
+        snapshot.counters[counter] = Summarize(histograms.counters[counter]);
+    }
+    return snapshot;
+}
+
+void ResetInstrumentation() {
+    Registry& registry = GetRegistry();
+    lock_guard lock(registry.threads_mutex);
+    registry.finished_threads.Reset();
+    for (Histograms* thread_histograms : registry.threads) {
+        thread_histograms->Reset();
+    }
+}
+
+ostream& operator<<(ostream& out, const InstrumentationSnapshot& snapshot) {
+    for (size_t stage = 0; stage < SEARCH_STAGE_COUNT; ++stage) {
+        PrintSummary(out, GetSearchStageName(static_cast<SearchStage>(stage)), " ns"sv, snapshot.stages[stage]);
+    }
+    for (size_t counter = 0; counter < SEARCH_COUNTER_COUNT; ++counter) {
+        PrintSummary(out, GetSearchCounterName(static_cast<SearchCounter>(counter)), ""sv, snapshot.counters[counter]);
+    }
+    return out;
+}
+
+#ifdef SEARCH_SERVER_INSTRUMENTATION
+
+namespace instrumentation {
+
+QueryScope::QueryScope() {
+    ++thread_state.query_depth;
+}
+
+QueryScope::~QueryScope() {
+    ThreadState& state = thread_state;
+    if (--state.query_depth > 0) {
+        return;
+    }
+    for (size_t stage = 0; stage < SEARCH_STAGE_COUNT; ++stage) {
+        if (state.is_stage_used[stage]) {
+            state.histograms.stages[stage].Record(state.stage_nanoseconds[stage]);
+        }
+    }
+    for (size_t counter = 0; counter < SEARCH_COUNTER_COUNT; ++counter) {
+        state.histograms.counters[counter].Record(state.counts[counter]);
+    }
+    state.stage_nanoseconds = {};
+    state.is_stage_used = {};
+    state.counts = {};
+}
+
+void AddStageTime(SearchStage stage, uint64_t nanoseconds) {
+    ThreadState& state = thread_state;
+    if (state.query_depth == 0) {
+        state.histograms.stages[static_cast<size_t>(stage)].Record(nanoseconds);
+        return;
+    }
+    state.stage_nanoseconds[static_cast<size_t>(stage)] += nanoseconds;
+    state.is_stage_used[static_cast<size_t>(stage)] = true;
+}
+
+void AddCount(SearchCounter counter, uint64_t count) {
+    thread_state.counts[static_cast<size_t>(counter)] += count;
+}
+
+}  // namespace instrumentation
+
+#endif
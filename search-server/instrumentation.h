@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+
+#include "log_duration.h"
+
+// Замеры этапов поиска включаются флагом компиляции SEARCH_SERVER_INSTRUMENTATION.
+// Без него макросы ниже раскрываются в пустоту, а снимок всегда пуст
+
+enum class SearchStage {
+    PARSE,
+    // Обход списков документов целиком, включая выполняемые внутри него этапы
+    POSTING_TRAVERSAL,
+    PREDICATE,
+    MINUS_WORDS,
+    TOP_K,
+};
+const size_t SEARCH_STAGE_COUNT = 5;
+
+enum class SearchCounter {
+    POSTINGS_VISITED,
+    DOCUMENTS_SCORED,
+};
+const size_t SEARCH_COUNTER_COUNT = 2;
+
+std::string_view GetSearchStageName(SearchStage stage);
+std::string_view GetSearchCounterName(SearchCounter counter);
+
+// Логарифмически-линейные корзины: значения меньше 2^sub_bucket_bits попадают каждое в свою корзину,
+// а каждая следующая степень двойки делится на 2^sub_bucket_bits равных корзин
+constexpr size_t GetLogLinearBucketCount(size_t sub_bucket_bits) {
+    return (size_t(1) << sub_bucket_bits) * (64 - sub_bucket_bits + 1);
+}
+size_t GetLogLinearBucket(uint64_t value, size_t sub_bucket_bits);
+uint64_t GetLogLinearBucketLowerBound(size_t bucket, size_t sub_bucket_bits);
+
+// Гистограмма в духе HDR: 16 корзин на каждую степень двойки, относительная погрешность не больше 1/16.
+// Пишет в неё один поток, поэтому счётчики меняются без атомарных сложений, а читать можно из любого потока
+class LatencyHistogram {
+public:
+    void Record(uint64_t value);
+    void Merge(const LatencyHistogram& other);
+    void Reset();
+
+    uint64_t GetCount() const;
+    uint64_t GetMax() const;
+    double GetMean() const;
+    // Нижняя граница корзины, в которую попало значение с заданной долей (от 0 до 1) меньших значений
+    uint64_t GetValueAtQuantile(double quantile) const;
+private:
+    static constexpr size_t sub_bucket_bits_ = 4;
+    static constexpr size_t bucket_count_ = GetLogLinearBucketCount(sub_bucket_bits_);
+
+    std::array<std::atomic<uint64_t>, bucket_count_> counts_{};
+    std::atomic<uint64_t> count_ = 0;
+    std::atomic<uint64_t> sum_ = 0;
+    std::atomic<uint64_t> max_ = 0;
+};
+
+struct HistogramSummary {
+    uint64_t count = 0;
+    double mean = 0.0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+};
+
+// Время этапов в наносекундах на один запрос и счётчики на один запрос, сведённые по всем потокам
+struct InstrumentationSnapshot {
+    std::array<HistogramSummary, SEARCH_STAGE_COUNT> stages;
+    std::array<HistogramSummary, SEARCH_COUNTER_COUNT> counters;
+};
+
+InstrumentationSnapshot GetInstrumentationSnapshot();
+// Сброс во время идущих запросов может потерять отдельные записи, но не портит гистограммы
+void ResetInstrumentation();
+
+std::ostream& operator<<(std::ostream& out, const InstrumentationSnapshot& snapshot);
+
+#ifdef SEARCH_SERVER_INSTRUMENTATION
+
+namespace instrumentation {
+
+// Время и счётчики этапов складываются за весь запрос и попадают в гистограммы, когда завершается внешний QueryScope.
+// Вне запроса время этапа записывается сразу
+class QueryScope {
+public:
+    QueryScope();
+    QueryScope(const QueryScope&) = delete;
+    QueryScope& operator=(const QueryScope&) = delete;
+    ~QueryScope();
+};
+
+void AddStageTime(SearchStage stage, uint64_t nanoseconds);
+void AddCount(SearchCounter counter, uint64_t count);
+
+class StageTimer {
+public:
+    explicit StageTimer(SearchStage stage)
+        : stage_(stage) {
+    }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    ~StageTimer() {
+        AddStageTime(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(LogDuration::Clock::now() - start_time_).count());
+    }
+private:
+    SearchStage stage_;
+    const LogDuration::Clock::time_point start_time_ = LogDuration::Clock::now();
+};
+
+// Для этапов, которые выполняются внутри обхода на каждом документе, замеряется каждый sample_period_-й вызов,
+// а время умножается на период: иначе чтение часов стоило бы дороже самого этапа
+class SampledStage {
+public:
+    explicit SampledStage(SearchStage stage)
+        : stage_(stage) {
+    }
+    SampledStage(const SampledStage&) = delete;
+    SampledStage& operator=(const SampledStage&) = delete;
+
+    ~SampledStage() {
+        if (call_count_ > 0) {
+            AddStageTime(stage_, sampled_nanoseconds_ * sample_period_);
+        }
+    }
+
+    template <typename Function>
+    auto operator()(Function function) {
+        if ((call_count_++ & (sample_period_ - 1)) != 0) {
+            return function();
+        }
+        const auto start_time = LogDuration::Clock::now();
+        if constexpr (std::is_void_v<decltype(function())>) {
+            function();
+            AddSample(start_time);
+        } else {
+            auto result = function();
+            AddSample(start_time);
+            return result;
+        }
+    }
+private:
+    static constexpr uint64_t sample_period_ = 16;
+
+    SearchStage stage_;
+    uint64_t call_count_ = 0;
+    uint64_t sampled_nanoseconds_ = 0;
+
+    void AddSample(LogDuration::Clock::time_point start_time) {
+        sampled_nanoseconds_ += std::chrono::duration_cast<std::chrono::nanoseconds>(LogDuration::Clock::now() - start_time).count();
+    }
+};
+
+}  // namespace instrumentation
+
+#define INSTRUMENT_SEARCH_QUERY() instrumentation::QueryScope PROFILE_CONCAT(instrumentationQuery, __LINE__)
+#define INSTRUMENT_SEARCH_STAGE(stage) instrumentation::StageTimer PROFILE_CONCAT(instrumentationStage, __LINE__)(SearchStage::stage)
+#define INSTRUMENT_SAMPLED_STAGE(name, stage) instrumentation::SampledStage name(SearchStage::stage)
+#define INSTRUMENT_SAMPLED_CALL(name, expression) name([&] { return (expression); })
+#define INSTRUMENT_SEARCH_COUNT(counter, count) instrumentation::AddCount(SearchCounter::counter, (count))
+
+#else
+
+#define INSTRUMENT_SEARCH_QUERY()
+#define INSTRUMENT_SEARCH_STAGE(stage)
+#define INSTRUMENT_SAMPLED_STAGE(name, stage)
+#define INSTRUMENT_SAMPLED_CALL(name, expression) (expression)
+#define INSTRUMENT_SEARCH_COUNT(counter, count)
+
+#endif
@@ -3,12 +3,27 @@
 #include <string>
 #include <vector>
 
+#include "benchmark.h"
 #include "process_queries.h"
 #include "search_server.h"
+#include "test_example_functions.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char* argv[]) {
+    // С ключом --test вместо примера запускаются проверки
+    if (argc > 1 && argv[1] == "--test"s) {
+        TestSearchServer();
+        return 0;
+    }
+    // С ключом --benchmark запускаются замеры, необязательный второй аргумент задаёт размер корпуса
+    if (argc > 1 && argv[1] == "--benchmark"s) {
+        // Откалиброванные пороги выводятся отдельно от замеров, чтобы их было удобно сохранить
+        PrintExecutionThresholds(cout, RunBenchmarks(cerr, argc > 2 ? stoi(argv[2]) : 100000));
+        cout << endl;
+        return 0;
+    }
+
     SearchServer search_server("and with"s);
 
     int id = 0;
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
-#include <vector>
+#include <iterator>
+#include <type_traits>
 
 template <typename Iterator>
 class IteratorRange {
@@ -36,35 +39,99 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
     return out;
 }
 
+// Границы страниц вычисляются по мере обхода, поэтому конструктор не проходит диапазон
+// и подходит для итераторов без произвольного доступа, например SearchServer::begin()
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        for (size_t left = distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = next(begin, current_page_size);
-            pages_.push_back({begin, current_page_end});
-            left -= current_page_size;
-            begin = current_page_end;
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        const_iterator(Iterator page_begin, Iterator end, size_t page_size)
+            : page_begin_(page_begin)
+            , page_end_(Advance(page_begin, end, page_size))
+            , end_(end)
+            , page_size_(page_size) {
+        }
+
+        value_type operator*() const {
+            return {page_begin_, page_end_};
+        }
+
+        const_iterator& operator++() {
+            page_begin_ = page_end_;
+            page_end_ = Advance(page_begin_, end_, page_size_);
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return page_begin_ == other.page_begin_;
         }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+    private:
+        Iterator page_begin_;
+        Iterator page_end_;
+        Iterator end_;
+        size_t page_size_;
+    };
+
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , end_(end)
+        , page_size_(std::max<size_t>(1, page_size)) {
     }
 
-    auto begin() const {
-        return pages_.begin();
+    const_iterator begin() const {
+        return const_iterator(begin_, end_, page_size_);
     }
 
-    auto end() const {
-        return pages_.end();
+    const_iterator end() const {
+        return const_iterator(end_, end_, page_size_);
     }
 
+    // Для итераторов без произвольного доступа проходит весь диапазон
     size_t size() const {
-        return pages_.size();
+        const size_t item_count = distance(begin_, end_);
+        return (item_count + page_size_ - 1) / page_size_;
+    }
+
+    // Для итераторов произвольного доступа страница находится за O(1), за концом диапазона страница пуста
+    IteratorRange<Iterator> GetPage(size_t index) const {
+        const Iterator page_begin = Advance(begin_, end_, index * page_size_);
+        return {page_begin, Advance(page_begin, end_, page_size_)};
     }
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator begin_;
+    Iterator end_;
+    size_t page_size_;
+
+    static Iterator Advance(Iterator it, Iterator end, size_t count) {
+        if constexpr (std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category, std::random_access_iterator_tag>) {
+            return it + std::min<typename std::iterator_traits<Iterator>::difference_type>(count, end - it);
+        } else {
+            for (; count > 0 && it != end; --count) {
+                ++it;
+            }
+            return it;
+        }
+    }
 };
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
-    return Paginator(begin(c), end(c), page_size);
+    return Paginator(std::begin(c), std::end(c), page_size);
 }
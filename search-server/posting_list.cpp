@@ -0,0 +1,290 @@
+#include "posting_list.h"
+
+#include <algorithm>
+
+using namespace std;
+
+PostingList::const_iterator::const_iterator(const PostingList* list, size_t base_pos, size_t insert_pos, size_t delete_pos)
+    : list_(list)
+    , base_ids_(list->GetBaseIds())
+    , base_freqs_(list->GetBaseFreqs())
+    , base_size_(list->GetBaseSize())
+    , base_pos_(base_pos)
+    , insert_pos_(insert_pos)
+    , delete_pos_(delete_pos) {
+    SkipDeleted();
+}
+
+PostingList::const_iterator::value_type PostingList::const_iterator::operator*() const {
+    if (IsBaseCurrent()) {
+        return {base_ids_[base_pos_], base_freqs_[base_pos_]};
+    }
+    return list_->inserted_[insert_pos_];
+}
+
+PostingList::const_iterator& PostingList::const_iterator::operator++() {
+    if (IsBaseCurrent()) {
+        ++base_pos_;
+    } else {
+        ++insert_pos_;
+    }
+    SkipDeleted();
+    return *this;
+}
+
+PostingList::const_iterator PostingList::const_iterator::operator++(int) {
+    auto result = *this;
+    ++*this;
+    return result;
+}
+
+void PostingList::const_iterator::Seek(int document_id) {
+    const auto& inserted = list_->inserted_;
+    const auto& deleted = list_->deleted_;
+    base_pos_ = lower_bound(base_ids_ + base_pos_, base_ids_ + base_size_, document_id) - base_ids_;
+    insert_pos_ = lower_bound(inserted.begin() + insert_pos_, inserted.end(), document_id,
+                              [](const pair<int, double>& item, int id) {
+        return item.first < id;
+    }) - inserted.begin();
+    delete_pos_ = lower_bound(deleted.begin() + delete_pos_, deleted.end(), document_id) - deleted.begin();
+    SkipDeleted();
+}
+
+bool PostingList::const_iterator::operator==(const const_iterator& other) const {
+    return list_ == other.list_ && base_pos_ == other.base_pos_ && insert_pos_ == other.insert_pos_;
+}
+
+bool PostingList::const_iterator::operator!=(const const_iterator& other) const {
+    return !(*this == other);
+}
+
+bool PostingList::const_iterator::IsBaseCurrent() const {
+    if (base_pos_ == base_size_) {
+        return false;
+    }
+    return insert_pos_ == list_->inserted_.size()
+            || base_ids_[base_pos_] < list_->inserted_[insert_pos_].first;
+}
+
+void PostingList::const_iterator::SkipDeleted() {
+    const auto& deleted = list_->deleted_;
+    while (base_pos_ < base_size_ && delete_pos_ < deleted.size()) {
+        if (deleted[delete_pos_] < base_ids_[base_pos_]) {
+            ++delete_pos_;
+        } else if (deleted[delete_pos_] == base_ids_[base_pos_]) {
+            ++delete_pos_;
+            ++base_pos_;
+        } else {
+            break;
+        }
+    }
+}
+
+PostingList::PostingList(const int* document_ids, const double* term_freqs, size_t size, double max_term_freq)
+    : mapped_document_ids_(document_ids)
+    , mapped_term_freqs_(term_freqs)
+    , mapped_size_(size)
+    , max_term_freq_(max_term_freq) {
+}
+
+void PostingList::Insert(int document_id, double term_freq) {
+    Detach();
+    max_term_freq_ = max(max_term_freq_, term_freq);
+    if (inserted_.empty() && (document_ids_.empty() || document_ids_.back() < document_id)) {
+        document_ids_.push_back(document_id);
+        term_freqs_.push_back(term_freq);
+        return;
+    }
+    const size_t pos = FindInBase(document_id);
+    if (pos != document_ids_.size()) {
+        const auto it = lower_bound(deleted_.begin(), deleted_.end(), document_id);
+        if (it != deleted_.end() && *it == document_id) {
+            deleted_.erase(it);
+        }
+        term_freqs_[pos] = term_freq;
+        return;
+    }
+    const auto it = lower_bound(inserted_.begin(), inserted_.end(), document_id,
+                                [](const pair<int, double>& item, int id) {
+        return item.first < id;
+    });
+    if (it != inserted_.end() && it->first == document_id) {
+        it->second = term_freq;
+    } else {
+        inserted_.insert(it, {document_id, term_freq});
+        MergeIfNeeded();
+    }
+}
+
+bool PostingList::Erase(int document_id) {
+    const auto it = lower_bound(inserted_.begin(), inserted_.end(), document_id,
+                                [](const pair<int, double>& item, int id) {
+        return item.first < id;
+    });
+    if (it != inserted_.end() && it->first == document_id) {
+        inserted_.erase(it);
+        return true;
+    }
+    if (FindInBase(document_id) == GetBaseSize()) {
+        return false;
+    }
+    const auto deleted_it = lower_bound(deleted_.begin(), deleted_.end(), document_id);
+    if (deleted_it != deleted_.end() && *deleted_it == document_id) {
+        return false;
+    }
+    if (mapped_document_ids_ == nullptr && document_ids_.back() == document_id && deleted_it == deleted_.end()) {
+        document_ids_.pop_back();
+        term_freqs_.pop_back();
+        return true;
+    }
+    deleted_.insert(deleted_it, document_id);
+    MergeIfNeeded();
+    return true;
+}
+
+size_t PostingList::Erase(const vector<int>& document_ids) {
+    if (document_ids.size() * buffer_ratio_ < size()) {
+        size_t erased_count = 0;
+        for (const int document_id : document_ids) {
+            erased_count += Erase(document_id);
+        }
+        return erased_count;
+    }
+    // Большую часть списка дешевле переписать за один проход, чем копить удаления в буфере
+    vector<int> kept_document_ids;
+    vector<double> kept_term_freqs;
+    kept_document_ids.reserve(size());
+    kept_term_freqs.reserve(size());
+    max_term_freq_ = 0.0;
+    auto erased_it = document_ids.begin();
+    for (const auto [document_id, term_freq] : *this) {
+        erased_it = lower_bound(erased_it, document_ids.end(), document_id);
+        if (erased_it != document_ids.end() && *erased_it == document_id) {
+            continue;
+        }
+        kept_document_ids.push_back(document_id);
+        kept_term_freqs.push_back(term_freq);
+        max_term_freq_ = max(max_term_freq_, term_freq);
+    }
+    const size_t erased_count = size() - kept_document_ids.size();
+    document_ids_.swap(kept_document_ids);
+    term_freqs_.swap(kept_term_freqs);
+    mapped_document_ids_ = nullptr;
+    mapped_term_freqs_ = nullptr;
+    mapped_size_ = 0;
+    inserted_.clear();
+    deleted_.clear();
+    return erased_count;
+}
+
+void PostingList::Merge() {
+    if (inserted_.empty() && deleted_.empty()) {
+        return;
+    }
+    vector<int> document_ids;
+    vector<double> term_freqs;
+    document_ids.reserve(size());
+    term_freqs.reserve(size());
+    max_term_freq_ = 0.0;
+    for (const auto [document_id, term_freq] : *this) {
+        document_ids.push_back(document_id);
+        term_freqs.push_back(term_freq);
+        max_term_freq_ = max(max_term_freq_, term_freq);
+    }
+    document_ids_.swap(document_ids);
+    term_freqs_.swap(term_freqs);
+    mapped_document_ids_ = nullptr;
+    mapped_term_freqs_ = nullptr;
+    mapped_size_ = 0;
+    inserted_.clear();
+    deleted_.clear();
+}
+
+void PostingList::RemapDocuments(const vector<int>& new_document_ids) {
+    Merge();
+    Detach();
+    for (int& document_id : document_ids_) {
+        document_id = new_document_ids[document_id];
+    }
+}
+
+bool PostingList::Contains(int document_id) const {
+    if (FindInBase(document_id) != GetBaseSize()) {
+        return !IsDeleted(document_id);
+    }
+    return binary_search(inserted_.begin(), inserted_.end(), pair{document_id, 0.0},
+                         [](const pair<int, double>& lhs, const pair<int, double>& rhs) {
+        return lhs.first < rhs.first;
+    });
+}
+
+size_t PostingList::size() const {
+    return GetBaseSize() - deleted_.size() + inserted_.size();
+}
+
+bool PostingList::empty() const {
+    return size() == 0;
+}
+
+size_t PostingList::GetMemoryUsage() const {
+    return sizeof(*this)
+            + document_ids_.capacity() * sizeof(int)
+            + term_freqs_.capacity() * sizeof(double)
+            + inserted_.capacity() * sizeof(pair<int, double>)
+            + deleted_.capacity() * sizeof(int);
+}
+
+double PostingList::GetMaxTermFreq() const {
+    return max_term_freq_;
+}
+
+PostingList::const_iterator PostingList::begin() const {
+    return {this, 0, 0, 0};
+}
+
+PostingList::const_iterator PostingList::end() const {
+    return {this, GetBaseSize(), inserted_.size(), deleted_.size()};
+}
+
+const int* PostingList::GetBaseIds() const {
+    return mapped_document_ids_ != nullptr ? mapped_document_ids_ : document_ids_.data();
+}
+
+const double* PostingList::GetBaseFreqs() const {
+    return mapped_term_freqs_ != nullptr ? mapped_term_freqs_ : term_freqs_.data();
+}
+
+size_t PostingList::GetBaseSize() const {
+    return mapped_document_ids_ != nullptr ? mapped_size_ : document_ids_.size();
+}
+
+void PostingList::Detach() {
+    if (mapped_document_ids_ == nullptr) {
+        return;
+    }
+    document_ids_.assign(mapped_document_ids_, mapped_document_ids_ + mapped_size_);
+    term_freqs_.assign(mapped_term_freqs_, mapped_term_freqs_ + mapped_size_);
+    mapped_document_ids_ = nullptr;
+    mapped_term_freqs_ = nullptr;
+    mapped_size_ = 0;
+}
+
+size_t PostingList::FindInBase(int document_id) const {
+    const int* ids = GetBaseIds();
+    const size_t size = GetBaseSize();
+    const int* it = lower_bound(ids, ids + size, document_id);
+    if (it == ids + size || *it != document_id) {
+        return size;
+    }
+    return it - ids;
+}
+
+bool PostingList::IsDeleted(int document_id) const {
+    return binary_search(deleted_.begin(), deleted_.end(), document_id);
+}
+
+void PostingList::MergeIfNeeded() {
+    if (inserted_.size() + deleted_.size() > max(min_buffer_size_, GetBaseSize() / buffer_ratio_)) {
+        Merge();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+class PostingList {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<int, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        const_iterator() = default;
+        const_iterator(const PostingList* list, size_t base_pos, size_t insert_pos, size_t delete_pos);
+
+        value_type operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+
+        void Seek(int document_id);
+
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+    private:
+        const PostingList* list_ = nullptr;
+        const int* base_ids_ = nullptr;
+        const double* base_freqs_ = nullptr;
+        size_t base_size_ = 0;
+        size_t base_pos_ = 0;
+        size_t insert_pos_ = 0;
+        size_t delete_pos_ = 0;
+
+        bool IsBaseCurrent() const;
+        void SkipDeleted();
+    };
+
+    PostingList() = default;
+    // Список ссылается на внешние массивы (например, на отображённый в память файл) до первого изменения
+    PostingList(const int* document_ids, const double* term_freqs, size_t size, double max_term_freq);
+
+    void Insert(int document_id, double term_freq);
+    bool Erase(int document_id);
+    // Удаляет документы из отсортированного списка и возвращает число удалённых
+    size_t Erase(const std::vector<int>& document_ids);
+    void Merge();
+    void RemapDocuments(const std::vector<int>& new_document_ids);
+
+    bool Contains(int document_id) const;
+    size_t size() const;
+    bool empty() const;
+    size_t GetMemoryUsage() const;
+    double GetMaxTermFreq() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+private:
+    static constexpr size_t min_buffer_size_ = 32;
+    static constexpr size_t buffer_ratio_ = 16;
+
+    std::vector<int> document_ids_;
+    std::vector<double> term_freqs_;
+    const int* mapped_document_ids_ = nullptr;
+    const double* mapped_term_freqs_ = nullptr;
+    size_t mapped_size_ = 0;
+    std::vector<std::pair<int, double>> inserted_;
+    std::vector<int> deleted_;
+    double max_term_freq_ = 0.0;
+
+    const int* GetBaseIds() const;
+    const double* GetBaseFreqs() const;
+    size_t GetBaseSize() const;
+    void Detach();
+
+    size_t FindInBase(int document_id) const;
+    bool IsDeleted(int document_id) const;
+    void MergeIfNeeded();
+};
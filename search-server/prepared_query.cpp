@@ -0,0 +1,7 @@
+#include "prepared_query.h"
+
+using namespace std;
+
+string_view PreparedQuery::GetText() const {
+    return text_ ? string_view(*text_) : string_view();
+}
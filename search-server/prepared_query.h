@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "small_vector.h"
+
+class SearchServer;
+
+// Запрос, разобранный один раз: слова сопоставлены идентификаторам терминов, IDF посчитан заранее.
+// Если индекс с тех пор изменился, сервер заново разбирает сохранённый текст запроса.
+// Без выделения памяти выполняется только FindTopDocuments с вектором-результатом, остальные перегрузки выделяют его заново
+class PreparedQuery {
+public:
+    std::string_view GetText() const;
+private:
+    friend class SearchServer;
+
+    struct Term {
+        std::string_view word;
+        int term_id = -1;
+        double inverse_document_freq = 0.0;
+    };
+
+    std::shared_ptr<const std::string> text_;
+    SmallVector<Term, 16> plus_terms_;
+    SmallVector<Term, 16> minus_terms_;
+    // Идентификатор экземпляра, а не адрес: новый сервер может оказаться по адресу уничтоженного с тем же поколением
+    uint64_t server_id_ = 0;
+    uint64_t generation_ = 0;
+};
@@ -3,22 +3,27 @@
 using namespace std;
 
 vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries) {
+    return ProcessQueries(ThreadPool::GetDefault(), search_server, queries);
+}
+
+vector<vector<Document>> ProcessQueries(ThreadPool& pool, const SearchServer& search_server, const vector<string>& queries) {
     vector<vector<Document>> documents_lists(queries.size());
-    transform(execution::par,
-              queries.begin(), queries.end(),
-              documents_lists.begin(),
-              [&search_server](const string& query) {
-        return search_server.FindTopDocuments(query);
+    search_server.FindTopDocumentsBatch(ThreadPoolPolicy(pool), queries, DocumentStatus::ACTUAL,
+                                        [&documents_lists](size_t query_index, vector<Document> documents) {
+        documents_lists[query_index] = move(documents);
     });
     return documents_lists;
 }
 
 vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries) {
+    return ProcessQueriesJoined(ThreadPool::GetDefault(), search_server, queries);
+}
+
+vector<Document> ProcessQueriesJoined(ThreadPool& pool, const SearchServer& search_server, const vector<string>& queries) {
     vector<Document> result;
-    for (const auto& local_documents : ProcessQueries(search_server, queries)) {
-        for (auto d: local_documents) {
-            result.push_back(d);
-        }
-    }
+    search_server.FindTopDocumentsBatch(ThreadPoolPolicy(pool), queries, DocumentStatus::ACTUAL,
+                                        [&result](size_t, vector<Document> documents) {
+        result.insert(result.end(), documents.begin(), documents.end());
+    });
     return result;
 }
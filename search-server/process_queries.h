@@ -1,9 +1,11 @@
 #pragma once
 
-#include <execution>
-
 #include "search_server.h"
+#include "thread_pool.h"
 
+// Без явного пула запросы выполняются в общем пуле ThreadPool::GetDefault()
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
+std::vector<std::vector<Document>> ProcessQueries(ThreadPool& pool, const SearchServer& search_server, const std::vector<std::string>& queries);
 
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+std::vector<Document> ProcessQueriesJoined(ThreadPool& pool, const SearchServer& search_server, const std::vector<std::string>& queries);
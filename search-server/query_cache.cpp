@@ -0,0 +1,88 @@
+#include "query_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+double QueryCacheStats::GetHitRate() const {
+    const uint64_t requests = hits + misses;
+    return requests == 0 ? 0.0 : hits * 1.0 / requests;
+}
+
+QueryCache::QueryCache(size_t capacity, size_t shard_count)
+    : shard_capacity_(max<size_t>(1, (capacity + max<size_t>(1, shard_count) - 1) / max<size_t>(1, shard_count)))
+    , shards_(max<size_t>(1, shard_count)) {
+}
+
+optional<vector<Document>> QueryCache::Find(const string& key, uint64_t generation) {
+    Shard& shard = GetShard(key);
+    lock_guard lock(shard.mutex);
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        ++shard.stats.misses;
+        return nullopt;
+    }
+    if (it->second->generation != generation) {
+        ++shard.stats.misses;
+        ++shard.stats.invalidations;
+        shard.entries.erase(it->second);
+        shard.index.erase(it);
+        return nullopt;
+    }
+    ++shard.stats.hits;
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    return shard.entries.front().documents;
+}
+
+void QueryCache::Insert(string key, uint64_t generation, vector<Document> documents) {
+    Shard& shard = GetShard(key);
+    lock_guard lock(shard.mutex);
+    const auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->generation = generation;
+        it->second->documents = move(documents);
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+    shard.entries.push_front({move(key), generation, move(documents)});
+    shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+    if (shard.entries.size() > shard_capacity_) {
+        shard.index.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+        ++shard.stats.evictions;
+    }
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        lock_guard lock(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+}
+
+QueryCacheStats QueryCache::GetStats() const {
+    QueryCacheStats result;
+    for (const Shard& shard : shards_) {
+        lock_guard lock(shard.mutex);
+        result.hits += shard.stats.hits;
+        result.misses += shard.stats.misses;
+        result.evictions += shard.stats.evictions;
+        result.invalidations += shard.stats.invalidations;
+        result.size += shard.entries.size();
+    }
+    return result;
+}
+
+size_t QueryCache::GetCapacity() const {
+    return shard_capacity_ * shards_.size();
+}
+
+size_t QueryCache::GetShardCount() const {
+    return shards_.size();
+}
+
+QueryCache::Shard& QueryCache::GetShard(const string& key) {
+    return shards_[hash<string>{}(key) % shards_.size()];
+}
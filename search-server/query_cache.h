@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+
+// Метка пользовательского предиката: запросы с одинаковой меткой считаются одним классом фильтра
+struct QueryCacheTag {
+    std::string_view name;
+};
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+    size_t size = 0;
+
+    double GetHitRate() const;
+};
+
+// Кэш результатов поиска: шарды с собственными мьютексами и вытеснением давно не использованных записей.
+// Запись, посчитанная для другого поколения индекса, считается промахом и удаляется
+class QueryCache {
+public:
+    explicit QueryCache(size_t capacity, size_t shard_count = default_shard_count_);
+
+    std::optional<std::vector<Document>> Find(const std::string& key, uint64_t generation);
+    void Insert(std::string key, uint64_t generation, std::vector<Document> documents);
+    void Clear();
+
+    QueryCacheStats GetStats() const;
+    size_t GetCapacity() const;
+    size_t GetShardCount() const;
+private:
+    static constexpr size_t default_shard_count_ = 16;
+
+    struct Entry {
+        std::string key;
+        uint64_t generation;
+        std::vector<Document> documents;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        QueryCacheStats stats;
+    };
+
+    size_t shard_capacity_;
+    std::vector<Shard> shards_;
+
+    Shard& GetShard(const std::string& key);
+};
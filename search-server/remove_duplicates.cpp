@@ -1,26 +1,33 @@
-#include "remove_duplicates.h"
-
-using namespace std;
-
-void RemoveDuplicates(SearchServer& search_server) {
-    set<string> comparison_set;
-    set<int> ids_to_remove;
-
-    for (const int document_id : search_server) {
-        std::map<std::string_view, double> id_words = search_server.GetWordFrequencies(document_id);
-        string words_to_compare = ""s;
-        for (auto it = id_words.begin(); it != id_words.end(); ++it) {
-            words_to_compare += it->first;
-        }
-        if (comparison_set.count(words_to_compare)) {
-            ids_to_remove.insert(document_id);
-        } else {
-            comparison_set.insert(words_to_compare);
-        }
-    }
-
-    for (auto id: ids_to_remove) {
-        cout << "Found duplicate document id "s << id << endl;
-        search_server.RemoveDocument(id);
-    }
-}
+#include "remove_duplicates.h"
+
+using namespace std;
+
+void RemoveDuplicates(SearchServer& search_server) {
+    // Отпечатки посчитаны при добавлении документов, поэтому проход не копирует слова и идёт параллельно
+    const ThreadPoolPolicy policy(ThreadPool::GetDefault());
+    const vector<int> ids_to_remove = search_server.FindDuplicates(policy);
+    for (auto id: ids_to_remove) {
+        cout << "Found duplicate document id "s << id << endl;
+    }
+    search_server.RemoveDocuments(policy, ids_to_remove);
+}
+
+void RemoveDuplicates(SegmentedSearchServer& search_server) {
+    search_server.Flush();
+    set<int> ids_to_remove;
+    {
+        // Дубликаты ищутся по одной версии индекса, пока остальные запросы продолжают работать
+        const auto snapshot = search_server.GetSnapshot();
+        unordered_set<Fingerprint, FingerprintHasher> fingerprints;
+        for (const int document_id : snapshot.GetDocumentIds()) {
+            if (!fingerprints.insert(*snapshot.GetFingerprint(document_id)).second) {
+                ids_to_remove.insert(document_id);
+            }
+        }
+    }
+
+    for (auto id: ids_to_remove) {
+        cout << "Found duplicate document id "s << id << endl;
+        search_server.RemoveDocument(id);
+    }
+}
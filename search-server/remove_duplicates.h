@@ -1,5 +1,7 @@
-#pragma once
-
-#include "search_server.h"
-
-void RemoveDuplicates(SearchServer& search_server);
+#pragma once
+
+#include "search_server.h"
+#include "segmented_search_server.h"
+
+void RemoveDuplicates(SearchServer& search_server);
+void RemoveDuplicates(SegmentedSearchServer& search_server);
@@ -1,39 +1,128 @@
 #include "request_queue.h"
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <thread>
+
 using namespace std;
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
+RequestQueue::RequestQueue(const SearchServer& search_server, chrono::seconds window)
     : search_server_(search_server)
-    , no_results_requests_(0)
-    , current_time_(0) {
+    , bucket_count_(max<int64_t>(1, window.count())) {
+    buckets_ = make_unique<Bucket[]>(bucket_count_);
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
-    const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(result.size());
+    const auto start_time = Clock::now();
+    auto result = search_server_.FindTopDocuments(raw_query, status);
+    const auto end_time = Clock::now();
+    RecordRequest(result.size(), end_time - start_time, end_time);
     return result;
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
-    const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(result.size());
-    return result;
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+void RequestQueue::RecordRequest(size_t result_count, Clock::duration latency, Clock::time_point time) {
+    Bucket& bucket = AcquireBucket(GetSecond(time));
+    bucket.result_counts[min<size_t>(result_count, MAX_RESULT_DOCUMENT_COUNT)].fetch_add(1, memory_order_relaxed);
+    const uint64_t nanoseconds = max<int64_t>(0, chrono::duration_cast<chrono::nanoseconds>(latency).count());
+    bucket.latency_counts[GetLogLinearBucket(nanoseconds, latency_sub_bucket_bits_)].fetch_add(1, memory_order_relaxed);
+    uint64_t latency_max = bucket.latency_max.load(memory_order_relaxed);
+    while (nanoseconds > latency_max && !bucket.latency_max.compare_exchange_weak(latency_max, nanoseconds, memory_order_relaxed)) {
+    }
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return no_results_requests_;
+    return static_cast<int>(GetStatistics().no_result_count);
+}
+
+RequestStatistics RequestQueue::GetStatistics() const {
+    return GetStatistics(chrono::seconds(bucket_count_));
 }
 
-void RequestQueue::AddRequest(int results_num) {
-    ++current_time_;
-    while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-        if (0 == requests_.front().results) {
-            --no_results_requests_;
+RequestStatistics RequestQueue::GetStatistics(chrono::seconds period) const {
+    const int64_t now = GetSecond(Clock::now());
+    // Пока очередь работает меньше окна, QPS считается по прошедшему времени
+    const int64_t period_seconds = max<int64_t>(1, min({static_cast<int64_t>(period.count()), static_cast<int64_t>(bucket_count_), now + 1}));
+
+    RequestStatistics statistics;
+    statistics.period = chrono::seconds(period_seconds);
+    array<uint64_t, latency_bucket_count_> latency_counts{};
+    uint64_t latency_max = 0;
+    for (size_t index = 0; index < bucket_count_; ++index) {
+        const Bucket& bucket = buckets_[index];
+        const int64_t second = bucket.second.load(memory_order_acquire);
+        if (second < 0 || second <= now - period_seconds || second > now) {
+            continue;
+        }
+        for (size_t result_count = 0; result_count < bucket.result_counts.size(); ++result_count) {
+            statistics.result_counts[result_count] += bucket.result_counts[result_count].load(memory_order_relaxed);
         }
-        requests_.pop_front();
+        for (size_t latency_bucket = 0; latency_bucket < latency_bucket_count_; ++latency_bucket) {
+            latency_counts[latency_bucket] += bucket.latency_counts[latency_bucket].load(memory_order_relaxed);
+        }
+        latency_max = max(latency_max, bucket.latency_max.load(memory_order_relaxed));
+    }
+
+    for (const uint64_t count : statistics.result_counts) {
+        statistics.request_count += count;
     }
-    requests_.push_back({current_time_, results_num});
-    if (0 == results_num) {
-        ++no_results_requests_;
+    statistics.no_result_count = statistics.result_counts[0];
+    statistics.queries_per_second = static_cast<double>(statistics.request_count) / period_seconds;
+    if (statistics.request_count > 0) {
+        statistics.no_result_rate = static_cast<double>(statistics.no_result_count) / statistics.request_count;
+    }
+
+    const uint64_t latency_total = accumulate(latency_counts.begin(), latency_counts.end(), uint64_t{0});
+    const auto quantile = [&](double quantile) {
+        const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(quantile * latency_total)));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < latency_bucket_count_; ++bucket) {
+            seen += latency_counts[bucket];
+            if (seen >= rank) {
+                return chrono::nanoseconds(GetLogLinearBucketLowerBound(bucket, latency_sub_bucket_bits_));
+            }
+        }
+        return chrono::nanoseconds(latency_max);
+    };
+    if (latency_total > 0) {
+        statistics.latency_p50 = quantile(0.5);
+        statistics.latency_p90 = quantile(0.9);
+        statistics.latency_p99 = quantile(0.99);
+        statistics.latency_max = chrono::nanoseconds(latency_max);
+    }
+    return statistics;
+}
+
+int64_t RequestQueue::GetSecond(Clock::time_point time) const {
+    return max<int64_t>(0, chrono::duration_cast<chrono::seconds>(time - start_time_).count());
+}
+
+RequestQueue::Bucket& RequestQueue::AcquireBucket(int64_t second) {
+    Bucket& bucket = buckets_[second % bucket_count_];
+    while (true) {
+        int64_t bucket_second = bucket.second.load(memory_order_acquire);
+        // Запрос, задержавшийся дольше секунды, учитывается в более новой корзине: она тоже внутри окна
+        if (bucket_second >= second) {
+            return bucket;
+        }
+        if (bucket_second == resetting_second_) {
+            this_thread::yield();
+            continue;
+        }
+        if (bucket.second.compare_exchange_weak(bucket_second, resetting_second_, memory_order_acq_rel)) {
+            for (auto& count : bucket.result_counts) {
+                count.store(0, memory_order_relaxed);
+            }
+            for (auto& count : bucket.latency_counts) {
+                count.store(0, memory_order_relaxed);
+            }
+            bucket.latency_max.store(0, memory_order_relaxed);
+            bucket.second.store(second, memory_order_release);
+            return bucket;
+        }
     }
 }
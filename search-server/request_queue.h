@@ -1,36 +1,77 @@
 #pragma once
 
-#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 
+#include "instrumentation.h"
 #include "search_server.h"
 
+struct RequestStatistics {
+    std::chrono::seconds period{0};
+    uint64_t request_count = 0;
+    uint64_t no_result_count = 0;
+    double queries_per_second = 0.0;
+    double no_result_rate = 0.0;
+    // Число запросов с данным числом результатов; в последнем элементе — с MAX_RESULT_DOCUMENT_COUNT результатами и больше
+    std::array<uint64_t, MAX_RESULT_DOCUMENT_COUNT + 1> result_counts{};
+    std::chrono::nanoseconds latency_p50{0};
+    std::chrono::nanoseconds latency_p90{0};
+    std::chrono::nanoseconds latency_p99{0};
+    std::chrono::nanoseconds latency_max{0};
+};
+
+// Статистика запросов за скользящее окно реального времени: кольцо посекундных корзин с атомарными счётчиками.
+// Запросы из разных потоков не блокируют друг друга, корзину устаревшей секунды обнуляет один поток, выигравший CAS.
+// Корзина занимает около 2 КБ, поэтому окно в минуту стоит около 120 КБ
 class RequestQueue {
 public:
-    RequestQueue(const SearchServer& search_server);
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestQueue(const SearchServer& search_server, std::chrono::seconds window = std::chrono::minutes(1));
 
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
+    // Учитывает запрос, выполненный в обход очереди
+    void RecordRequest(size_t result_count, Clock::duration latency, Clock::time_point time = Clock::now());
+
     int GetNoResultRequests() const;
+    RequestStatistics GetStatistics() const;
+    // Статистика за последние period секунд, но не больше окна
+    RequestStatistics GetStatistics(std::chrono::seconds period) const;
 private:
-    struct QueryResult {
-        uint64_t timestamp;
-        int results;
+    // Задержки в наносекундах: по 4 корзины на каждую степень двойки
+    static constexpr size_t latency_sub_bucket_bits_ = 2;
+    static constexpr size_t latency_bucket_count_ = GetLogLinearBucketCount(latency_sub_bucket_bits_);
+    static constexpr int64_t no_second_ = -1;
+    static constexpr int64_t resetting_second_ = -2;
+
+    struct Bucket {
+        std::atomic<int64_t> second = no_second_;
+        std::array<std::atomic<uint64_t>, MAX_RESULT_DOCUMENT_COUNT + 1> result_counts{};
+        std::array<std::atomic<uint64_t>, latency_bucket_count_> latency_counts{};
+        std::atomic<uint64_t> latency_max = 0;
     };
-    std::deque<QueryResult> requests_;
+
     const SearchServer& search_server_;
-    int no_results_requests_;
-    uint64_t current_time_;
-    const static int min_in_day_ = 1440;
+    const Clock::time_point start_time_ = Clock::now();
+    std::unique_ptr<Bucket[]> buckets_;
+    size_t bucket_count_;
 
-    void AddRequest(int results_num);
+    int64_t GetSecond(Clock::time_point time) const;
+    Bucket& AcquireBucket(int64_t second);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequest(result.size());
+    const auto start_time = Clock::now();
+    auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
+    const auto end_time = Clock::now();
+    RecordRequest(result.size(), end_time - start_time, end_time);
     return result;
 }
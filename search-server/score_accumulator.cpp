@@ -0,0 +1,55 @@
+#include "score_accumulator.h"
+
+#include <cstdint>
+
+using namespace std;
+
+ScoreAccumulator::ScoreAccumulator(size_t expected_size) {
+    size_t capacity = 16;
+    while (capacity < expected_size * 2) {
+        capacity *= 2;
+    }
+    keys_.assign(capacity, empty_key_);
+    values_.assign(capacity, 0.0);
+}
+
+double& ScoreAccumulator::operator[](int document_id) {
+    size_t slot = FindSlot(document_id);
+    if (keys_[slot] == empty_key_) {
+        if ((size_ + 1) * 2 > keys_.size()) {
+            Grow();
+            slot = FindSlot(document_id);
+        }
+        keys_[slot] = document_id;
+        ++size_;
+    }
+    return values_[slot];
+}
+
+size_t ScoreAccumulator::size() const {
+    return size_;
+}
+
+size_t ScoreAccumulator::FindSlot(int document_id) const {
+    const size_t mask = keys_.size() - 1;
+    // Мультипликативное хеширование разносит соседние id по разным слотам
+    size_t slot = (static_cast<uint64_t>(document_id) * 0x9E3779B97F4A7C15ull >> 20) & mask;
+    while (keys_[slot] != empty_key_ && keys_[slot] != document_id) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void ScoreAccumulator::Grow() {
+    vector<int> keys(keys_.size() * 2, empty_key_);
+    vector<double> values(values_.size() * 2, 0.0);
+    keys_.swap(keys);
+    values_.swap(values);
+    for (size_t slot = 0; slot < keys.size(); ++slot) {
+        if (keys[slot] != empty_key_) {
+            const size_t new_slot = FindSlot(keys[slot]);
+            keys_[new_slot] = keys[slot];
+            values_[new_slot] = values[slot];
+        }
+    }
+}
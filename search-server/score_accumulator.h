@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class ScoreAccumulator {
+public:
+    explicit ScoreAccumulator(size_t expected_size = 0);
+
+    double& operator[](int document_id);
+
+    template <typename Function>
+    void ForEach(Function function) const;
+
+    size_t size() const;
+private:
+    static constexpr int empty_key_ = -1;
+
+    std::vector<int> keys_;
+    std::vector<double> values_;
+    size_t size_ = 0;
+
+    size_t FindSlot(int document_id) const;
+    void Grow();
+};
+
+template <typename Function>
+void ScoreAccumulator::ForEach(Function function) const {
+    for (size_t slot = 0; slot < keys_.size(); ++slot) {
+        if (keys_[slot] != empty_key_) {
+            function(keys_[slot], values_[slot]);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#include "search_budget.h"
+
+using namespace std;
+
+SearchBudget SearchBudget::WithMaxPostings(size_t max_postings) {
+    SearchBudget budget;
+    budget.max_postings = max_postings;
+    return budget;
+}
+
+SearchBudget SearchBudget::WithTimeout(Clock::duration timeout) {
+    SearchBudget budget;
+    budget.deadline = Clock::now() + timeout;
+    return budget;
+}
+
+BudgetMeter::BudgetMeter(const SearchBudget& budget)
+    : budget_(budget) {
+}
+
+BudgetExhaustion BudgetMeter::GetExhaustion() const {
+    return exhaustion_;
+}
+
+size_t BudgetMeter::GetSpentPostings() const {
+    return spent_postings_;
+}
+
+bool BudgetMeter::CheckDeadline() {
+    next_deadline_check_ += deadline_check_interval_;
+    if (budget_.deadline && SearchBudget::Clock::now() >= *budget_.deadline) {
+        exhaustion_ = BudgetExhaustion::DEADLINE;
+        return false;
+    }
+    return true;
+}
+
+void SearchBudgetCounter::Record(BudgetExhaustion exhaustion) {
+    query_count_.fetch_add(1, memory_order_relaxed);
+    counts_[static_cast<size_t>(exhaustion)].fetch_add(1, memory_order_relaxed);
+}
+
+SearchBudgetStats SearchBudgetCounter::GetStats() const {
+    SearchBudgetStats stats;
+    stats.query_count = query_count_.load(memory_order_relaxed);
+    stats.postings_exhausted = counts_[static_cast<size_t>(BudgetExhaustion::POSTINGS)].load(memory_order_relaxed);
+    stats.deadline_exceeded = counts_[static_cast<size_t>(BudgetExhaustion::DEADLINE)].load(memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "document.h"
+
+// Ограничение работы одного запроса: сколько записей списков документов можно прочитать и к какому моменту нужен ответ
+struct SearchBudget {
+    using Clock = std::chrono::steady_clock;
+
+    size_t max_postings = std::numeric_limits<size_t>::max();
+    std::optional<Clock::time_point> deadline;
+
+    static SearchBudget WithMaxPostings(size_t max_postings);
+    static SearchBudget WithTimeout(Clock::duration timeout);
+};
+
+// Частичный результат — лучшие документы по записям, прочитанным до исчерпания бюджета
+struct SearchResult {
+    std::vector<Document> documents;
+    bool is_partial = false;
+};
+
+enum class BudgetExhaustion {
+    NONE,
+    POSTINGS,
+    DEADLINE,
+};
+
+// Расход бюджета одним запросом. Часы опрашиваются не на каждой записи, а раз в deadline_check_interval_ записей
+class BudgetMeter {
+public:
+    explicit BudgetMeter(const SearchBudget& budget);
+
+    // Возвращает false, если записей больше читать нельзя
+    bool Spend() {
+        if (spent_postings_ == budget_.max_postings) {
+            exhaustion_ = BudgetExhaustion::POSTINGS;
+            return false;
+        }
+        if (spent_postings_ == next_deadline_check_ && !CheckDeadline()) {
+            return false;
+        }
+        ++spent_postings_;
+        return true;
+    }
+
+    BudgetExhaustion GetExhaustion() const;
+    size_t GetSpentPostings() const;
+private:
+    static constexpr size_t deadline_check_interval_ = 1024;
+
+    SearchBudget budget_;
+    size_t spent_postings_ = 0;
+    size_t next_deadline_check_ = 0;
+    BudgetExhaustion exhaustion_ = BudgetExhaustion::NONE;
+
+    bool CheckDeadline();
+};
+
+struct SearchBudgetStats {
+    uint64_t query_count = 0;
+    uint64_t postings_exhausted = 0;
+    uint64_t deadline_exceeded = 0;
+};
+
+class SearchBudgetCounter {
+public:
+    void Record(BudgetExhaustion exhaustion);
+    SearchBudgetStats GetStats() const;
+private:
+    std::atomic<uint64_t> query_count_ = 0;
+    std::array<std::atomic<uint64_t>, 3> counts_{};
+};
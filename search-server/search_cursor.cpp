@@ -0,0 +1,46 @@
+#include "search_cursor.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+
+#include "string_processing.h"
+
+using namespace std;
+
+namespace {
+
+template <typename Number>
+bool ParseInteger(string_view text, Number& value) {
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    return error == errc() && end == text.data() + text.size();
+}
+
+}
+
+SearchCursor::SearchCursor(const Document& last_document)
+    : last_document_(last_document) {
+}
+
+string SearchCursor::ToString() const {
+    // Шестнадцатеричная запись числа с плавающей точкой переводится обратно без потери битов
+    char relevance[32];
+    snprintf(relevance, sizeof(relevance), "%a", last_document_.relevance);
+    return string(relevance) + ' ' + to_string(last_document_.rating) + ' ' + to_string(last_document_.id);
+}
+
+optional<SearchCursor> SearchCursor::FromString(string_view text) {
+    const auto words = SplitIntoWordsView(text);
+    if (words.size() != 3) {
+        return nullopt;
+    }
+    const string relevance_text(words[0]);
+    char* relevance_end = nullptr;
+    Document last_document;
+    last_document.relevance = strtod(relevance_text.c_str(), &relevance_end);
+    if (relevance_end != relevance_text.c_str() + relevance_text.size()
+            || !ParseInteger(words[1], last_document.rating) || !ParseInteger(words[2], last_document.id)) {
+        return nullopt;
+    }
+    return SearchCursor(last_document);
+}
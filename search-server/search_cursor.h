@@ -0,0 +1,28 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Место в выдаче сразу после последнего документа страницы. Строковое представление точно сохраняет релевантность,
+// поэтому курсор можно отдать клиенту и принять обратно
+class SearchCursor {
+public:
+    std::string ToString() const;
+    static std::optional<SearchCursor> FromString(std::string_view text);
+private:
+    friend class SearchServer;
+
+    Document last_document_;
+
+    explicit SearchCursor(const Document& last_document);
+};
+
+struct SearchPage {
+    std::vector<Document> documents;
+    // Нет, если страница оказалась последней
+    std::optional<SearchCursor> next_cursor;
+};
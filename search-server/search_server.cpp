@@ -1,5 +1,8 @@
 #include "search_server.h"
 
+#include <atomic>
+#include <cstring>
+
 using namespace std;
 
 SearchServer::SearchServer(const string& stop_words_text)
@@ -10,84 +13,797 @@ SearchServer::SearchServer(const string_view& stop_words_text)
     : SearchServer::SearchServer(SplitIntoWordsView(stop_words_text)) {
 }
 
+SearchServer::SearchServer(const SearchServer& other)
+    : stop_words_(other.stop_words_)
+    , terms_(other.terms_)
+    , word_to_document_freqs_(other.word_to_document_freqs_)
+    , document_to_word_frequency_(other.document_to_word_frequency_)
+    , documents_(other.documents_)
+    , snapshot_file_(other.snapshot_file_)
+    , query_evaluation_(other.query_evaluation_)
+    , partition_count_(other.partition_count_)
+    , execution_thresholds_(other.execution_thresholds_)
+    , duplicate_policy_(other.duplicate_policy_)
+    , posting_layout_(other.posting_layout_)
+    , status_postings_(other.status_postings_ ? make_unique<StatusPostings>(*other.status_postings_) : nullptr)
+    , generation_(other.generation_)
+    , query_cache_(other.query_cache_ ? make_unique<QueryCache>(other.query_cache_->GetCapacity(), other.query_cache_->GetShardCount())
+                                      : nullptr) {
+}
+
+SearchServer& SearchServer::operator=(const SearchServer& other) {
+    if (this != &other) {
+        *this = SearchServer(other);
+    }
+    return *this;
+}
+
 void SearchServer::AddDocument(int document_id, const string_view& document, DocumentStatus status,
                                const vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || documents_.FindOrdinal(document_id)) {
         throw invalid_argument("Invalid document_id"s);
     }
     const auto words = SplitIntoWordsNoStop(document);
+    const Fingerprint fingerprint = ComputeFingerprint(words);
+    CheckDuplicate(document_id, fingerprint);
+
     const double inv_word_count = 1.0 / words.size();
+    map<int, double> word_freqs;
     for (const string_view& word: words) {
-        words_.push_back(string(word.begin(), word.size()));
-        word_to_document_freqs_[words_.back()][document_id] += inv_word_count;
-        document_to_word_frequency_[document_id][words_.back()] += inv_word_count;
+        word_freqs[terms_.Intern(word)] += inv_word_count;
+    }
+    if (word_to_document_freqs_.size() < terms_.GetIdBound()) {
+        word_to_document_freqs_.resize(terms_.GetIdBound());
+    }
+    const int ordinal = documents_.Add(document_id, status, ComputeAverageRating(ratings), fingerprint);
+    for (const auto [term_id, term_freq] : word_freqs) {
+        word_to_document_freqs_[term_id].Insert(ordinal, term_freq);
+    }
+    vector<TermFrequency> term_freqs;
+    term_freqs.reserve(word_freqs.size());
+    for (const auto [term_id, term_freq] : word_freqs) {
+        term_freqs.push_back({term_id, term_freq});
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-    document_ids_.insert(document_id);
+    document_to_word_frequency_.Add(move(term_freqs));
+    AddStatusPostings(ordinal);
+    ++generation_;
 }
 
-vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status) const {
-    return FindTopDocuments(
-                raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+void SearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    AddDocuments(execution::seq, documents);
+}
+
+void SearchServer::AddDocumentsFrom(const SearchServer& source, const set<int>& excluded_document_ids) {
+    for (const int document_id : source.documents_) {
+        if (!excluded_document_ids.count(document_id) && documents_.FindOrdinal(document_id)) {
+            throw invalid_argument("Invalid document_id"s);
+        }
+    }
+    for (size_t source_ordinal = 0; source_ordinal < source.documents_.GetOrdinalBound(); ++source_ordinal) {
+        const int document_id = source.documents_.GetDocumentId(source_ordinal);
+        if (document_id < 0 || excluded_document_ids.count(document_id)) {
+            continue;
+        }
+        vector<TermFrequency> term_freqs;
+        for (const auto [source_term_id, term_freq] : source.document_to_word_frequency_.Get(source_ordinal)) {
+            term_freqs.push_back({terms_.Intern(source.terms_.GetTerm(source_term_id)), term_freq});
+        }
+        sort(term_freqs.begin(), term_freqs.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+            return lhs.term_id < rhs.term_id;
+        });
+        if (word_to_document_freqs_.size() < terms_.GetIdBound()) {
+            word_to_document_freqs_.resize(terms_.GetIdBound());
+        }
+        const Fingerprint fingerprint = source.documents_.GetFingerprint(source_ordinal);
+        const int ordinal = documents_.Add(document_id, source.documents_.GetStatus(source_ordinal), source.documents_.GetRating(source_ordinal),
+                                           fingerprint);
+        for (const auto [term_id, term_freq] : term_freqs) {
+            word_to_document_freqs_[term_id].Insert(ordinal, term_freq);
+        }
+        document_to_word_frequency_.Add(move(term_freqs));
+        AddStatusPostings(ordinal);
+        ++generation_;
+    }
+}
+
+void SearchServer::UpdateDocument(int document_id, const string_view& document, DocumentStatus status, const vector<int>& ratings) {
+    const int ordinal = GetOrdinalForUpdate(document_id);
+    const auto words = SplitIntoWordsNoStop(document);
+    const Fingerprint fingerprint = ComputeFingerprint(words);
+    CheckDuplicate(document_id, fingerprint);
+
+    const double inv_word_count = 1.0 / words.size();
+    map<int, double> word_freqs;
+    for (const string_view& word: words) {
+        word_freqs[terms_.Intern(word)] += inv_word_count;
+    }
+    if (word_to_document_freqs_.size() < terms_.GetIdBound()) {
+        word_to_document_freqs_.resize(terms_.GetIdBound());
+    }
+    EraseStatusPostings(ordinal);
+    // Старые и новые слова упорядочены по идентификаторам терминов, поэтому различия находятся одним проходом слиянием
+    const auto old_term_freqs = document_to_word_frequency_.Get(ordinal);
+    auto old_it = old_term_freqs.begin();
+    for (const auto [term_id, term_freq] : word_freqs) {
+        for (; old_it != old_term_freqs.end() && old_it->term_id < term_id; ++old_it) {
+            EraseTermPosting(old_it->term_id, ordinal);
+        }
+        if (old_it != old_term_freqs.end() && old_it->term_id == term_id) {
+            if (old_it->term_freq != term_freq) {
+                word_to_document_freqs_[term_id].Insert(ordinal, term_freq);
+            }
+            ++old_it;
+        } else {
+            word_to_document_freqs_[term_id].Insert(ordinal, term_freq);
+        }
+    }
+    for (; old_it != old_term_freqs.end(); ++old_it) {
+        EraseTermPosting(old_it->term_id, ordinal);
+    }
+
+    vector<TermFrequency> term_freqs;
+    term_freqs.reserve(word_freqs.size());
+    for (const auto [term_id, term_freq] : word_freqs) {
+        term_freqs.push_back({term_id, term_freq});
+    }
+    document_to_word_frequency_.Set(ordinal, move(term_freqs));
+    documents_.SetFingerprint(ordinal, fingerprint);
+    documents_.SetStatus(ordinal, status);
+    documents_.SetRating(ordinal, ComputeAverageRating(ratings));
+    AddStatusPostings(ordinal);
+    ++generation_;
+}
+
+void SearchServer::UpdateDocumentStatus(int document_id, DocumentStatus status) {
+    const int ordinal = GetOrdinalForUpdate(document_id);
+    EraseStatusPostings(ordinal);
+    documents_.SetStatus(ordinal, status);
+    AddStatusPostings(ordinal);
+    BumpGenerationKeepingIdf();
+}
+
+void SearchServer::UpdateDocumentRating(int document_id, const vector<int>& ratings) {
+    documents_.SetRating(GetOrdinalForUpdate(document_id), ComputeAverageRating(ratings));
+    BumpGenerationKeepingIdf();
+}
+
+vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(execution::seq, raw_query, status, top_count);
 }
 
 vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+SearchPage SearchServer::FindTopDocumentsPage(const string_view& raw_query, DocumentStatus status, size_t page_size,
+                                              const optional<SearchCursor>& cursor) const {
+    if (!status_postings_) {
+        return FindTopDocumentsPage(
+                    raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        }, page_size, cursor);
+    }
+    INSTRUMENT_SEARCH_QUERY();
+    const auto query = ParseQuery(raw_query);
+    ScoredTerms plus_terms;
+    for (const string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            plus_terms.push_back({&status_postings_->Get(*term_id, status), ComputeWordInverseDocumentFreq(*term_id)});
+        }
+    }
+    MinusPostings minus_postings;
+    for (const string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            minus_postings.push_back(&word_to_document_freqs_[*term_id]);
+        }
+    }
+    return ScorePage(plus_terms, minus_postings, [](int document_id, DocumentStatus document_status, int rating) {
+        return true;
+    }, page_size, cursor);
+}
+
+SearchPage SearchServer::FindTopDocumentsPage(const string_view& raw_query, size_t page_size, const optional<SearchCursor>& cursor) const {
+    return FindTopDocumentsPage(raw_query, DocumentStatus::ACTUAL, page_size, cursor);
+}
+
+SearchResult SearchServer::FindTopDocumentsWithBudget(const string_view& raw_query, const SearchBudget& budget, DocumentStatus status,
+                                                      size_t top_count) const {
+    INSTRUMENT_SEARCH_QUERY();
+    if (!status_postings_) {
+        return FindTopDocumentsWithBudget(
+                    raw_query, budget, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        }, top_count);
+    }
+    const auto query = ParseQuery(raw_query);
+    ScoredTerms plus_terms;
+    for (const string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            plus_terms.push_back({&status_postings_->Get(*term_id, status), ComputeWordInverseDocumentFreq(*term_id)});
+        }
+    }
+    MinusPostings minus_postings;
+    for (const string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            minus_postings.push_back(&word_to_document_freqs_[*term_id]);
+        }
+    }
+    return ScoreWithinBudget(move(plus_terms), minus_postings, budget, [](int document_id, DocumentStatus document_status, int rating) {
+        return true;
+    }, top_count);
+}
+
+SearchResult SearchServer::FindTopDocumentsWithBudget(const string_view& raw_query, const SearchBudget& budget) const {
+    return FindTopDocumentsWithBudget(raw_query, budget, DocumentStatus::ACTUAL);
+}
+
+SearchBudgetStats SearchServer::GetSearchBudgetStats() const {
+    return search_budget_counter_->GetStats();
+}
+
+PreparedQuery SearchServer::PrepareQuery(string_view raw_query) const {
+    PreparedQuery prepared_query;
+    prepared_query.text_ = make_shared<const string>(raw_query);
+    const auto query = ParseQuery(*prepared_query.text_);
+    for (const string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            prepared_query.plus_terms_.push_back({word, *term_id, ComputeWordInverseDocumentFreq(*term_id)});
+        }
+    }
+    for (const string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            prepared_query.minus_terms_.push_back({word, *term_id});
+        }
+    }
+    prepared_query.server_id_ = instance_id_;
+    prepared_query.generation_ = generation_;
+    return prepared_query;
+}
+
+vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status, size_t top_count) const {
+    INSTRUMENT_SEARCH_QUERY();
+    if (status_postings_ && IsPreparedHere(query)) {
+        TermWeights plus_terms;
+        for (const auto& term : query.plus_terms_) {
+            plus_terms.push_back({term.term_id, term.inverse_document_freq});
+        }
+        MinusPostings minus_postings;
+        for (const auto& term : query.minus_terms_) {
+            minus_postings.push_back(&word_to_document_freqs_[term.term_id]);
+        }
+        return FindTopDocumentsInStatus(plus_terms, minus_postings, status, top_count);
+    }
+    return FindTopDocuments(
+                query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    }, top_count);
+}
+
+vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const {
+    return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+void SearchServer::EnableQueryCache(size_t capacity) {
+    query_cache_ = make_unique<QueryCache>(capacity);
+}
+
+void SearchServer::DisableQueryCache() {
+    query_cache_.reset();
+}
+
+QueryCacheStats SearchServer::GetQueryCacheStats() const {
+    return query_cache_ ? query_cache_->GetStats() : QueryCacheStats{};
+}
+
+uint64_t SearchServer::GetGeneration() const {
+    return generation_;
+}
+
+void SearchServer::SetQueryEvaluation(QueryEvaluation query_evaluation) {
+    query_evaluation_ = query_evaluation;
+}
+
+QueryEvaluation SearchServer::GetQueryEvaluation() const {
+    return query_evaluation_;
+}
+
+void SearchServer::SetPartitionCount(size_t partition_count) {
+    partition_count_ = max<size_t>(1, partition_count);
+}
+
+size_t SearchServer::GetPartitionCount() const {
+    return partition_count_;
+}
+
+void SearchServer::SetPostingLayout(PostingLayout posting_layout) {
+    posting_layout_ = posting_layout;
+    if (posting_layout == PostingLayout::ORDINAL) {
+        status_postings_.reset();
+        return;
+    }
+    status_postings_ = make_unique<StatusPostings>(posting_layout == PostingLayout::IMPACT_ORDERED);
+    status_postings_->Resize(word_to_document_freqs_.size());
+    for (size_t term_id = 0; term_id < word_to_document_freqs_.size(); ++term_id) {
+        for (const auto [ordinal, term_freq] : word_to_document_freqs_[term_id]) {
+            status_postings_->Insert(term_id, documents_.GetStatus(ordinal), ordinal, term_freq);
+        }
+        status_postings_->Flush(term_id);
+    }
+}
+
+PostingLayout SearchServer::GetPostingLayout() const {
+    return posting_layout_;
+}
+
+void SearchServer::SetExecutionThresholds(const ExecutionThresholds& thresholds) {
+    execution_thresholds_ = thresholds;
+}
+
+ExecutionThresholds SearchServer::GetExecutionThresholds() const {
+    return execution_thresholds_;
+}
+
+ExecutionStrategyStats SearchServer::GetExecutionStrategyStats() const {
+    return execution_strategy_counter_->GetStats();
+}
+
 int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
 
-set<int>::const_iterator SearchServer::begin() const {
-    return document_ids_.begin();
+DocumentTable::IdIterator SearchServer::begin() const {
+    return documents_.begin();
+}
+
+DocumentTable::IdIterator SearchServer::end() const {
+    return documents_.end();
+}
+
+map<string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    map<string_view, double> result;
+    if (const auto ordinal = documents_.FindOrdinal(document_id)) {
+        for (const auto [term_id, freq] : document_to_word_frequency_.Get(*ordinal)) {
+            result.emplace(terms_.GetTerm(term_id), freq);
+        }
+    }
+    return result;
+}
+
+optional<int> SearchServer::GetTermId(string_view word) const {
+    return terms_.Find(word);
+}
+
+string_view SearchServer::GetTerm(int term_id) const {
+    return terms_.GetTerm(term_id);
+}
+
+size_t SearchServer::GetTermCount() const {
+    return terms_.size();
+}
+
+int SearchServer::GetDocumentFrequency(string_view word) const {
+    const auto term_id = terms_.Find(word);
+    return term_id ? static_cast<int>(word_to_document_freqs_[*term_id].size()) : 0;
+}
+
+optional<TermStatistics> SearchServer::GetTermStatistics(string_view word) const {
+    const auto term_id = terms_.Find(word);
+    if (!term_id) {
+        return nullopt;
+    }
+    return TermStatistics{terms_.GetTerm(*term_id), static_cast<int>(word_to_document_freqs_[*term_id].size()),
+                          ComputeWordInverseDocumentFreq(*term_id)};
+}
+
+void SearchServer::SetDuplicatePolicy(DuplicatePolicy duplicate_policy) {
+    duplicate_policy_ = duplicate_policy;
+}
+
+DuplicatePolicy SearchServer::GetDuplicatePolicy() const {
+    return duplicate_policy_;
 }
 
-set<int>::const_iterator SearchServer::end() const {
-    return document_ids_.end();
+optional<Fingerprint> SearchServer::GetFingerprint(int document_id) const {
+    if (const auto ordinal = documents_.FindOrdinal(document_id)) {
+        return documents_.GetFingerprint(*ordinal);
+    }
+    return nullopt;
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    auto result = document_to_word_frequency_.find(document_id);
+optional<int> SearchServer::FindDuplicate(int document_id) const {
+    if (const auto fingerprint = GetFingerprint(document_id)) {
+        return FindDocumentWithFingerprint(*fingerprint, document_id);
+    }
+    return nullopt;
+}
 
-    static const map<string_view, double> dummy_map;
-    return result == document_to_word_frequency_.end() ? dummy_map : document_to_word_frequency_.at(document_id);
+vector<int> SearchServer::FindDuplicates() const {
+    return FindDuplicates(execution::seq);
+}
+
+vector<TermStatistics> SearchServer::GetCorpusStatistics() const {
+    idf_table_->Refresh(generation_, GetDocumentCount(), word_to_document_freqs_);
+    vector<TermStatistics> result;
+    result.reserve(terms_.size());
+    for (size_t term_id = 0; term_id < word_to_document_freqs_.size(); ++term_id) {
+        const auto& postings = word_to_document_freqs_[term_id];
+        if (!postings.empty()) {
+            result.push_back({terms_.GetTerm(term_id), static_cast<int>(postings.size()), ComputeWordInverseDocumentFreq(term_id)});
+        }
+    }
+    return result;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    if (document_ids_.count(document_id) != 0) {
-        for (auto& [word, freq] : document_to_word_frequency_[document_id]) {
-            word_to_document_freqs_[word].erase(document_id);
+    const auto ordinal = documents_.FindOrdinal(document_id);
+    if (ordinal) {
+        EraseStatusPostings(*ordinal);
+        for (const auto [term_id, freq] : document_to_word_frequency_.Get(*ordinal)) {
+            EraseTermPosting(term_id, *ordinal);
         }
-        documents_.erase(document_id);
-        document_ids_.erase(document_id);
-        document_to_word_frequency_.erase(document_id);
+        RemoveDocumentData({*ordinal});
     }
 }
 
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    RemoveDocuments(execution::seq, document_ids);
+}
+
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
     const auto query = ParseQuery(raw_query);
+    const int ordinal = documents_.GetOrdinal(document_id);
     vector<string_view> matched_words;
     for (const string_view& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(string{word}).count(document_id)) {
+        if (IsWordInDocument(word, ordinal)) {
             matched_words.push_back(word);
         }
     }
     for (const string_view& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(string{word}).count(document_id)) {
+        if (IsWordInDocument(word, ordinal)) {
             matched_words.clear();
             break;
         }
     }
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, documents_.GetStatus(ordinal)};
+}
+
+string SearchServer::MakeQueryCacheKey(const Query& query, const string& predicate_key, size_t top_count) const {
+    // Слова не содержат пробелов и управляющих символов, поэтому такие разделители делают ключ однозначным
+    string key = to_string(top_count);
+    key += '\n';
+    for (const string_view& word : query.plus_words) {
+        key += word;
+        key += ' ';
+    }
+    key += '\n';
+    for (const string_view& word : query.minus_words) {
+        key += word;
+        key += ' ';
+    }
+    key += '\n';
+    key += predicate_key;
+    return key;
+}
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+    if (!IsPreparedHere(query)) {
+        return MatchDocument(query.GetText(), document_id);
+    }
+    const int ordinal = documents_.GetOrdinal(document_id);
+    vector<string_view> matched_words;
+    for (const auto& term : query.minus_terms_) {
+        if (word_to_document_freqs_[term.term_id].Contains(ordinal)) {
+            return {matched_words, documents_.GetStatus(ordinal)};
+        }
+    }
+    for (const auto& term : query.plus_terms_) {
+        if (word_to_document_freqs_[term.term_id].Contains(ordinal)) {
+            matched_words.push_back(term.word);
+        }
+    }
+    return {matched_words, documents_.GetStatus(ordinal)};
+}
+
+vector<Document> SearchServer::SelectTopDocuments(const map<int, double>& document_to_relevance, size_t top_count) const {
+    INSTRUMENT_SEARCH_STAGE(TOP_K);
+    TopDocuments top_documents(top_count);
+    for (const auto [ordinal, relevance] : document_to_relevance) {
+        top_documents.Add({documents_.GetDocumentId(ordinal), relevance, documents_.GetRating(ordinal)});
+    }
+    return top_documents.Extract();
+}
+
+vector<Document> SearchServer::SelectTopDocuments(const ScoreAccumulator& document_to_relevance, const MinusPostings& minus_postings, size_t top_count) const {
+    vector<pair<int, double>> candidates;
+    candidates.reserve(document_to_relevance.size());
+    {
+        INSTRUMENT_SEARCH_STAGE(MINUS_WORDS);
+        document_to_relevance.ForEach([&](int ordinal, double relevance) {
+            const bool has_minus_word = any_of(minus_postings.begin(), minus_postings.end(),
+                                               [ordinal](const PostingList* postings) {
+                return postings->Contains(ordinal);
+            });
+            if (!has_minus_word) {
+                candidates.push_back({ordinal, relevance});
+            }
+        });
+    }
+    INSTRUMENT_SEARCH_STAGE(TOP_K);
+    TopDocuments top_documents(top_count);
+    for (const auto& [ordinal, relevance] : candidates) {
+        top_documents.Add({documents_.GetDocumentId(ordinal), relevance, documents_.GetRating(ordinal)});
+    }
+    return top_documents.Extract();
+}
+
+vector<Document> SearchServer::FindTopDocumentsInStatus(const TermWeights& plus_terms, const MinusPostings& minus_postings, DocumentStatus status,
+                                                       size_t top_count) const {
+    if (query_evaluation_ == QueryEvaluation::EXHAUSTIVE) {
+        map<int, double> document_to_relevance;
+        {
+            INSTRUMENT_SEARCH_STAGE(POSTING_TRAVERSAL);
+            for (const auto& [term_id, inverse_document_freq] : plus_terms) {
+                const auto& postings = status_postings_->Get(term_id, status);
+                for (const auto [ordinal, term_freq] : postings) {
+                    document_to_relevance[ordinal] += term_freq * inverse_document_freq;
+                }
+                INSTRUMENT_SEARCH_COUNT(POSTINGS_VISITED, postings.size());
+            }
+            INSTRUMENT_SEARCH_COUNT(DOCUMENTS_SCORED, document_to_relevance.size());
+        }
+        INSTRUMENT_SEARCH_STAGE(MINUS_WORDS);
+        for (const PostingList* postings : minus_postings) {
+            for (const auto [ordinal, _] : *postings) {
+                document_to_relevance.erase(ordinal);
+            }
+        }
+        return SelectTopDocuments(document_to_relevance, top_count);
+    }
+    if (status_postings_->IsImpactOrdered() && plus_terms.size() == 1) {
+        const auto [term_id, inverse_document_freq] = plus_terms[0];
+        return FindTopDocumentsByImpact(status_postings_->GetByImpact(term_id, status), inverse_document_freq, minus_postings, top_count);
+    }
+    ScoredTerms scored_terms;
+    for (const auto& [term_id, inverse_document_freq] : plus_terms) {
+        scored_terms.push_back({&status_postings_->Get(term_id, status), inverse_document_freq});
+    }
+    TopDocuments top_documents(top_count);
+    // Раздел содержит только документы нужного статуса, поэтому предикат ничего не отсекает
+    ScoreMaxScore(scored_terms, minus_postings, [](int document_id, DocumentStatus document_status, int rating) {
+        return true;
+    }, top_documents);
+    return top_documents.Extract();
+}
+
+vector<Document> SearchServer::FindTopDocumentsInStatus(const Query& query, DocumentStatus status, size_t top_count) const {
+    TermWeights plus_terms;
+    for (const string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            plus_terms.push_back({*term_id, ComputeWordInverseDocumentFreq(*term_id)});
+        }
+    }
+    MinusPostings minus_postings;
+    for (const string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            minus_postings.push_back(&word_to_document_freqs_[*term_id]);
+        }
+    }
+    return FindTopDocumentsInStatus(plus_terms, minus_postings, status, top_count);
+}
+
+vector<Document> SearchServer::FindTopDocumentsByImpact(const ImpactPostingList& postings, double inverse_document_freq,
+                                                        const MinusPostings& minus_postings, size_t top_count) const {
+    TopDocuments top_documents(top_count);
+    if (top_count == 0) {
+        return top_documents.Extract();
+    }
+    INSTRUMENT_SEARCH_STAGE(POSTING_TRAVERSAL);
+    for (const auto& [ordinal, term_freq] : postings) {
+        INSTRUMENT_SEARCH_COUNT(POSTINGS_VISITED, 1);
+        const double relevance = term_freq * inverse_document_freq;
+        // Частоты дальше только меньше, поэтому ни один из оставшихся документов уже не попадёт в топ
+        if (top_documents.IsFull() && relevance <= top_documents.GetWorst().relevance - RELEVANCE_EPSILON) {
+            break;
+        }
+        const bool has_minus_word = any_of(minus_postings.begin(), minus_postings.end(),
+                                           [ordinal = ordinal](const PostingList* minus) {
+            return minus->Contains(ordinal);
+        });
+        if (!has_minus_word) {
+            INSTRUMENT_SEARCH_COUNT(DOCUMENTS_SCORED, 1);
+            top_documents.Add({documents_.GetDocumentId(ordinal), relevance, documents_.GetRating(ordinal)});
+        }
+    }
+    return top_documents.Extract();
+}
+
+void SearchServer::SaveSnapshot(const string& path) const {
+    SnapshotWriter writer(path);
+    writer.WriteStrings(vector<string_view>(stop_words_.begin(), stop_words_.end()));
+
+    const size_t term_count = terms_.GetIdBound();
+    vector<string_view> terms(term_count);
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        terms[term_id] = terms_.GetTerm(term_id);
+    }
+    writer.WriteStrings(terms);
+    const vector<int> term_lookup_table = terms_.BuildLookupTable();
+    writer.WriteValue<uint64_t>(terms_.size());
+    writer.WriteValue<uint64_t>(term_lookup_table.size());
+    writer.WriteArray(term_lookup_table.data(), term_lookup_table.size());
+    writer.Align();
+
+    // Удалённые документы в снимок не попадают, поэтому порядковые номера сжимаются
+    vector<int> new_ordinals(documents_.GetOrdinalBound(), -1);
+    vector<int> live_ordinals;
+    for (size_t ordinal = 0; ordinal < new_ordinals.size(); ++ordinal) {
+        if (documents_.GetDocumentId(ordinal) >= 0) {
+            new_ordinals[ordinal] = static_cast<int>(live_ordinals.size());
+            live_ordinals.push_back(ordinal);
+        }
+    }
+
+    vector<uint64_t> posting_offsets(term_count + 1, 0);
+    vector<double> max_term_freqs(term_count, 0.0);
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        const auto& postings = word_to_document_freqs_[term_id];
+        posting_offsets[term_id + 1] = posting_offsets[term_id] + postings.size();
+        max_term_freqs[term_id] = postings.GetMaxTermFreq();
+    }
+    writer.WriteValue<uint64_t>(term_count);
+    writer.WriteArray(posting_offsets.data(), posting_offsets.size());
+    writer.Align();
+    writer.WriteArray(max_term_freqs.data(), max_term_freqs.size());
+    writer.Align();
+    for (const auto& postings : word_to_document_freqs_) {
+        for (const auto& [ordinal, _] : postings) {
+            const int32_t new_ordinal = new_ordinals[ordinal];
+            writer.WriteArray(&new_ordinal, 1);
+        }
+    }
+    writer.Align();
+    for (const auto& postings : word_to_document_freqs_) {
+        for (const auto& [_, term_freq] : postings) {
+            writer.WriteArray(&term_freq, 1);
+        }
+    }
+    writer.Align();
+
+    vector<int32_t> document_ids, ratings;
+    vector<DocumentStatus> statuses;
+    vector<Fingerprint> fingerprints;
+    vector<uint64_t> word_offsets(1, 0);
+    for (const int ordinal : live_ordinals) {
+        document_ids.push_back(documents_.GetDocumentId(ordinal));
+        statuses.push_back(documents_.GetStatus(ordinal));
+        ratings.push_back(documents_.GetRating(ordinal));
+        fingerprints.push_back(documents_.GetFingerprint(ordinal));
+        word_offsets.push_back(word_offsets.back() + document_to_word_frequency_.Get(ordinal).size());
+    }
+    // Индексы по идентификаторам и отпечаткам записываются упорядоченными, чтобы загрузка искала по ним двоичным поиском
+    vector<DocumentIdEntry> id_index;
+    vector<FingerprintEntry> fingerprint_index(live_ordinals.size());
+    // Выравнивание записей обнуляется, чтобы одинаковые индексы давали одинаковые файлы и контрольные суммы
+    memset(static_cast<void*>(fingerprint_index.data()), 0, fingerprint_index.size() * sizeof(FingerprintEntry));
+    for (size_t ordinal = 0; ordinal < live_ordinals.size(); ++ordinal) {
+        id_index.push_back({document_ids[ordinal], static_cast<int>(ordinal)});
+        fingerprint_index[ordinal].fingerprint = fingerprints[ordinal];
+        fingerprint_index[ordinal].document_id = document_ids[ordinal];
+    }
+    sort(id_index.begin(), id_index.end(), [](const DocumentIdEntry& lhs, const DocumentIdEntry& rhs) {
+        return lhs.document_id < rhs.document_id;
+    });
+    sort(fingerprint_index.begin(), fingerprint_index.end(), [](const FingerprintEntry& lhs, const FingerprintEntry& rhs) {
+        if (lhs.fingerprint != rhs.fingerprint) {
+            return lhs.fingerprint < rhs.fingerprint;
+        }
+        return lhs.document_id < rhs.document_id;
+    });
+    writer.WriteValue<uint64_t>(live_ordinals.size());
+    writer.WriteArray(document_ids.data(), document_ids.size());
+    writer.Align();
+    writer.WriteArray(statuses.data(), statuses.size());
+    writer.Align();
+    writer.WriteArray(ratings.data(), ratings.size());
+    writer.Align();
+    writer.WriteArray(fingerprints.data(), fingerprints.size());
+    writer.Align();
+    writer.WriteArray(id_index.data(), id_index.size());
+    writer.Align();
+    writer.WriteArray(fingerprint_index.data(), fingerprint_index.size());
+    writer.Align();
+    writer.WriteArray(word_offsets.data(), word_offsets.size());
+    writer.Align();
+    for (const int ordinal : live_ordinals) {
+        for (const auto& [term_id, term_freq] : document_to_word_frequency_.Get(ordinal)) {
+            TermFrequency entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.term_id = term_id;
+            entry.term_freq = term_freq;
+            writer.WriteArray(&entry, 1);
+        }
+    }
+    writer.Finish();
+}
+
+SearchServer SearchServer::LoadSnapshot(const string& path, SnapshotVerification verification) {
+    auto file = make_shared<const MappedFile>(path);
+    SnapshotReader reader(*file, verification);
+    const bool is_full = verification == SnapshotVerification::FULL;
+    SearchServer search_server(reader.ReadStrings());
+
+    const SnapshotStrings terms = reader.ReadStringArray();
+    const uint64_t live_term_count = reader.ReadValue<uint64_t>();
+    const uint64_t term_lookup_table_size = reader.ReadValue<uint64_t>();
+    // Степень двойки больше числа терминов: иначе в таблице нет свободной ячейки, на которой останавливается поиск
+    if (term_lookup_table_size == 0 || (term_lookup_table_size & (term_lookup_table_size - 1)) != 0
+            || live_term_count >= term_lookup_table_size || live_term_count > terms.count) {
+        throw runtime_error("Snapshot is corrupted"s);
+    }
+    const int32_t* term_lookup_table = reader.ReadArray<int32_t>(term_lookup_table_size);
+    search_server.terms_ = TermDictionary(terms.offsets, terms.chars, terms.count, live_term_count, term_lookup_table, term_lookup_table_size);
+
+    const uint64_t term_count = reader.ReadValue<uint64_t>();
+    if (term_count != terms.count) {
+        throw runtime_error("Snapshot is corrupted"s);
+    }
+    const uint64_t* posting_offsets = reader.ReadArray<uint64_t>(term_count + 1);
+    const double* max_term_freqs = reader.ReadArray<double>(term_count);
+    const int32_t* posting_ordinals = reader.ReadArray<int32_t>(posting_offsets[term_count]);
+    const double* posting_term_freqs = reader.ReadArray<double>(posting_offsets[term_count]);
+    if (is_full) {
+        SnapshotReader::CheckOffsets(posting_offsets, term_count);
+    }
+    search_server.word_to_document_freqs_.reserve(term_count);
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        const uint64_t first = posting_offsets[term_id];
+        search_server.word_to_document_freqs_.emplace_back(posting_ordinals + first, posting_term_freqs + first,
+                                                          posting_offsets[term_id + 1] - first, max_term_freqs[term_id]);
+    }
+
+    const uint64_t document_count = reader.ReadValue<uint64_t>();
+    const int32_t* document_ids = reader.ReadArray<int32_t>(document_count);
+    const DocumentStatus* statuses = reader.ReadArray<DocumentStatus>(document_count);
+    const int32_t* ratings = reader.ReadArray<int32_t>(document_count);
+    const Fingerprint* fingerprints = reader.ReadArray<Fingerprint>(document_count);
+    const DocumentIdEntry* id_index = reader.ReadArray<DocumentIdEntry>(document_count);
+    const FingerprintEntry* fingerprint_index = reader.ReadArray<FingerprintEntry>(document_count);
+    search_server.documents_ = DocumentTable(document_ids, statuses, ratings, fingerprints, id_index, fingerprint_index, document_count);
+
+    const uint64_t* word_offsets = reader.ReadArray<uint64_t>(document_count + 1);
+    const TermFrequency* word_freqs = reader.ReadArray<TermFrequency>(word_offsets[document_count]);
+    if (is_full) {
+        SnapshotReader::CheckOffsets(word_offsets, document_count);
+        for (size_t i = 0; i < posting_offsets[term_count]; ++i) {
+            if (posting_ordinals[i] < 0 || static_cast<uint64_t>(posting_ordinals[i]) >= document_count) {
+                throw runtime_error("Snapshot is corrupted"s);
+            }
+        }
+        for (size_t i = 0; i < word_offsets[document_count]; ++i) {
+            if (word_freqs[i].term_id < 0 || static_cast<uint64_t>(word_freqs[i].term_id) >= term_count) {
+                throw runtime_error("Snapshot is corrupted"s);
+            }
+        }
+        for (size_t i = 0; i < document_count; ++i) {
+            if (id_index[i].ordinal < 0 || static_cast<uint64_t>(id_index[i].ordinal) >= document_count
+                    || (i > 0 && id_index[i - 1].document_id >= id_index[i].document_id)) {
+                throw runtime_error("Snapshot is corrupted"s);
+            }
+        }
+    }
+    search_server.document_to_word_frequency_ = ForwardIndex(word_offsets, word_freqs, document_count);
+
+    search_server.snapshot_file_ = move(file);
+    return search_server;
+}
+
+uint64_t SearchServer::MakeInstanceId() {
+    static atomic<uint64_t> next_instance_id = 1;
+    return next_instance_id.fetch_add(1, memory_order_relaxed);
+}
+
+bool SearchServer::IsPreparedHere(const PreparedQuery& query) const {
+    return query.server_id_ == instance_id_ && query.generation_ == generation_;
 }
 
 bool SearchServer::IsStopWord(const string_view& word) const {
@@ -95,17 +811,17 @@ bool SearchServer::IsStopWord(const string_view& word) const {
 }
 
 bool SearchServer::IsValidWord(const string_view& word) {
-    return none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-    });
+    return !HasControlCharacters(word);
 }
 
 vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view& text) const {
+    optional<string_view> invalid_word;
+    const auto all_words = SplitIntoWordsView(text, invalid_word);
+    if (invalid_word) {
+        throw invalid_argument("Word "s + string{*invalid_word} + " is invalid"s);
+    }
     vector<string_view> words;
-    for (const string_view& word : SplitIntoWordsView(text)) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("Word "s + string{word} + " is invalid"s);
-        }
+    for (const string_view& word : all_words) {
         if (!IsStopWord(word)) {
             words.push_back(word);
         }
@@ -118,6 +834,67 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return !ratings.empty() ? (accumulate(ratings.begin(), ratings.end(), 0)) / static_cast<int>(ratings.size()) : rating_sum;
 }
 
+SearchServer::ParsedDocument SearchServer::ParseDocument(const RawDocument& document) const {
+    ParsedDocument result;
+    try {
+        const auto words = SplitIntoWordsNoStop(document.text);
+        const double inv_word_count = 1.0 / words.size();
+        for (const string_view& word : words) {
+            result.word_freqs[word] += inv_word_count;
+        }
+        FingerprintBuilder fingerprint_builder;
+        for (const auto& [word, _] : result.word_freqs) {
+            fingerprint_builder.Add(word);
+        }
+        result.fingerprint = fingerprint_builder.Get();
+    } catch (const invalid_argument& e) {
+        result.error = e.what();
+    }
+    return result;
+}
+
+void SearchServer::CheckDocuments(const vector<RawDocument>& documents, const vector<ParsedDocument>& parsed_documents) const {
+    unordered_set<int> batch_ids;
+    unordered_map<Fingerprint, int, FingerprintHasher> batch_fingerprints;
+    for (size_t index = 0; index < documents.size(); ++index) {
+        const int document_id = documents[index].id;
+        if ((document_id < 0) || documents_.FindOrdinal(document_id) || !batch_ids.insert(document_id).second) {
+            throw invalid_argument("Invalid document_id"s);
+        }
+        if (!parsed_documents[index].error.empty()) {
+            throw invalid_argument(parsed_documents[index].error);
+        }
+        if (duplicate_policy_ == DuplicatePolicy::REJECT) {
+            CheckDuplicate(document_id, parsed_documents[index].fingerprint);
+            const auto [it, inserted] = batch_fingerprints.emplace(parsed_documents[index].fingerprint, document_id);
+            if (!inserted) {
+                throw invalid_argument("Document "s + to_string(document_id) + " duplicates document "s + to_string(it->second));
+            }
+        }
+    }
+}
+
+Fingerprint SearchServer::ComputeFingerprint(const vector<string_view>& words) {
+    const set<string_view> unique_words(words.begin(), words.end());
+    FingerprintBuilder fingerprint_builder;
+    for (const string_view word : unique_words) {
+        fingerprint_builder.Add(word);
+    }
+    return fingerprint_builder.Get();
+}
+
+optional<int> SearchServer::FindDocumentWithFingerprint(Fingerprint fingerprint, int excluded_document_id) const {
+    return documents_.FindDocumentWithFingerprint(fingerprint, excluded_document_id);
+}
+
+void SearchServer::CheckDuplicate(int document_id, Fingerprint fingerprint) const {
+    if (duplicate_policy_ == DuplicatePolicy::REJECT) {
+        if (const auto duplicate_id = FindDocumentWithFingerprint(fingerprint, document_id)) {
+            throw invalid_argument("Document "s + to_string(document_id) + " duplicates document "s + to_string(*duplicate_id));
+        }
+    }
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(const string_view& text) const {
     if (text.empty()) {
         throw invalid_argument("Query word is empty"s);
@@ -135,6 +912,7 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(const string_view& text) co
 }
 
 SearchServer::Query SearchServer::ParseQuery(const string_view& text) const {
+    INSTRUMENT_SEARCH_STAGE(PARSE);
     Query result;
     for (const string_view& word : SplitIntoWordsView(text)) {
         const auto query_word = ParseQueryWord(word);
@@ -146,6 +924,7 @@ SearchServer::Query SearchServer::ParseQuery(const string_view& text) const {
 }
 
 SearchServer::QueryParPolicy SearchServer::ParseQueryParPolicy(const std::string_view& text) const {
+    INSTRUMENT_SEARCH_STAGE(PARSE);
     QueryParPolicy result;
     for (const string_view& word : SplitIntoWordsView(text)) {
         const auto query_word = ParseQueryWord(word);
@@ -153,17 +932,100 @@ SearchServer::QueryParPolicy SearchServer::ParseQueryParPolicy(const std::string
             query_word.is_minus ? result.minus_words.push_back(query_word.data) : result.plus_words.push_back(query_word.data);
         }
     }
-    sort(std::execution::par, result.plus_words.begin(), result.plus_words.end());
-    auto last_plus = unique(std::execution::par, result.plus_words.begin(), result.plus_words.end());
+    // В запросе обычно меньше десятка слов: запуск потоков обошёлся бы дороже самой сортировки
+    sort(result.plus_words.begin(), result.plus_words.end());
+    auto last_plus = unique(result.plus_words.begin(), result.plus_words.end());
     result.plus_words.erase(last_plus, result.plus_words.end());
 
-    sort(std::execution::par, result.minus_words.begin(), result.minus_words.end());
-    auto last_minus = unique(std::execution::par, result.minus_words.begin(), result.minus_words.end());
+    sort(result.minus_words.begin(), result.minus_words.end());
+    auto last_minus = unique(result.minus_words.begin(), result.minus_words.end());
     result.minus_words.erase(last_minus, result.minus_words.end());
 
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string_view& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+bool SearchServer::IsWordInDocument(string_view word, int ordinal) const {
+    const auto term_id = terms_.Find(word);
+    return term_id && word_to_document_freqs_[*term_id].Contains(ordinal);
+}
+
+int SearchServer::GetOrdinalForUpdate(int document_id) const {
+    const auto ordinal = documents_.FindOrdinal(document_id);
+    if (!ordinal) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    return *ordinal;
+}
+
+void SearchServer::EraseTermPosting(int term_id, int ordinal) {
+    auto& postings = word_to_document_freqs_[term_id];
+    postings.Erase(ordinal);
+    if (postings.empty()) {
+        postings = PostingList();
+        if (status_postings_) {
+            status_postings_->Clear(term_id);
+        }
+        terms_.Erase(term_id);
+    }
+}
+
+void SearchServer::AddStatusPostings(int ordinal) {
+    if (!status_postings_) {
+        return;
+    }
+    status_postings_->Resize(word_to_document_freqs_.size());
+    const DocumentStatus status = documents_.GetStatus(ordinal);
+    for (const auto [term_id, term_freq] : document_to_word_frequency_.Get(ordinal)) {
+        status_postings_->Insert(term_id, status, ordinal, term_freq);
+        status_postings_->Flush(term_id);
+    }
+}
+
+void SearchServer::EraseStatusPostings(int ordinal) {
+    if (!status_postings_) {
+        return;
+    }
+    const DocumentStatus status = documents_.GetStatus(ordinal);
+    for (const auto [term_id, term_freq] : document_to_word_frequency_.Get(ordinal)) {
+        status_postings_->Erase(term_id, status, ordinal, term_freq);
+    }
+}
+
+void SearchServer::BumpGenerationKeepingIdf() {
+    idf_table_->Carry(generation_, generation_ + 1);
+    ++generation_;
+}
+
+void SearchServer::RemoveDocumentData(const vector<int>& ordinals) {
+    for (const int ordinal : ordinals) {
+        document_to_word_frequency_.Clear(ordinal);
+        documents_.Remove(ordinal);
+    }
+    ++generation_;
+    if (documents_.NeedsCompaction()) {
+        CompactDocuments();
+    }
+}
+
+void SearchServer::CompactDocuments() {
+    const vector<int> new_ordinals = documents_.Compact();
+    for (auto& postings : word_to_document_freqs_) {
+        if (!postings.empty()) {
+            postings.RemapDocuments(new_ordinals);
+        }
+    }
+    if (status_postings_) {
+        status_postings_->RemapDocuments(new_ordinals);
+    }
+    document_to_word_frequency_.RemapDocuments(new_ordinals, documents_.GetOrdinalBound());
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(int term_id, const CollectionStatistics* statistics) const {
+    if (statistics) {
+        const auto it = statistics->document_freqs.find(terms_.GetTerm(term_id));
+        if (it != statistics->document_freqs.end()) {
+            return log(statistics->document_count * 1.0 / it->second);
+        }
+    }
+    return idf_table_->Get(term_id, generation_, GetDocumentCount(), word_to_document_freqs_);
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <utility>
 #include <map>
 #include <set>
@@ -10,62 +11,247 @@
 #include <string_view>
 #include <deque>
 #include <future>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <type_traits>
+#include <limits>
 
 #include "document.h"
-#include "concurrent_map.h"
+#include "document_table.h"
+#include "execution_strategy.h"
+#include "fingerprint.h"
+#include "forward_index.h"
+#include "idf_table.h"
+#include "instrumentation.h"
+#include "index_snapshot.h"
 #include "log_duration.h"
+#include "posting_list.h"
+#include "prepared_query.h"
+#include "query_cache.h"
+#include "score_accumulator.h"
+#include "search_budget.h"
+#include "search_cursor.h"
+#include "small_vector.h"
+#include "status_postings.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
+#include "top_documents.h"
 
 using namespace std::string_literals;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
+// Статистика всей коллекции для индекса, который хранит только её часть
+struct CollectionStatistics {
+    int document_count = 0;
+    std::map<std::string_view, int> document_freqs;
+};
+
+enum class QueryEvaluation {
+    EXHAUSTIVE,
+    MAX_SCORE,
+};
+
+// Что делать с документом, набор слов которого совпадает с уже добавленным
+enum class DuplicatePolicy {
+    ALLOW,
+    REJECT,
+};
+
 class SearchServer {
 public:
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
     explicit SearchServer(const std::string& stop_words_text);
     explicit SearchServer(const std::string_view& stop_words_text);
+    // Копия получает тот же индекс и настройки, а кэш запросов, таблицу IDF и счётчики заводит свои, пустые
+    SearchServer(const SearchServer& other);
+    SearchServer& operator=(const SearchServer& other);
+    SearchServer(SearchServer&&) = default;
+    SearchServer& operator=(SearchServer&&) = default;
 
     void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
 
+    template <typename ExecutionPolicy>
+    void AddDocuments(const ExecutionPolicy& policy, const std::vector<RawDocument>& documents);
+    void AddDocuments(const std::vector<RawDocument>& documents);
+    // Переносит документы другого индекса, кроме исключённых, сохраняя их статусы, рейтинги и отпечатки.
+    // Политика дубликатов здесь не применяется
+    void AddDocumentsFrom(const SearchServer& source, const std::set<int>& excluded_document_ids);
+
+    // Меняются только записи списков документов для слов, частота которых изменилась. Документ сохраняет свой порядковый номер
+    void UpdateDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+    // Обновления без текста не трогают общие списки документов и IDF. Если списки разложены по статусам,
+    // смена статуса переносит записи документа в другой раздел
+    void UpdateDocumentStatus(int document_id, DocumentStatus status);
+    void UpdateDocumentRating(int document_id, const std::vector<int>& ratings);
+
     template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status) const;
-    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query) const;
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
 
+    // Результаты запросов с одной меткой кэшируются, если кэш включён: метка должна однозначно задавать предикат
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, QueryCacheTag cache_tag,
+                                           DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, QueryCacheTag cache_tag,
+                                           DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Пакетный поиск: список документов каждого слова читается один раз для всех запросов блока, в которых оно встречается.
+    // Результаты передаются обработчику по порядку запросов, не дожидаясь конца пакета
+    template <typename ExecutionPolicy, typename ResultHandler>
+    void FindTopDocumentsBatch(const ExecutionPolicy& policy, const std::vector<std::string>& raw_queries, DocumentStatus status,
+                               ResultHandler handle_result) const;
+
+    // Страница выдачи после курсора. Курсор хранит только последний документ страницы, поэтому документы предыдущих страниц
+    // снова оцениваются при обходе и лишь затем отбрасываются: время страницы растёт вместе со временем полного запроса.
+    // От глубины страницы зависят только память и работа кучи, которая держит не больше page_size документов.
+    // Страницы одного запроса к неизменному индексу вместе дают ту же выдачу, что и поиск без ограничения числа документов:
+    // курсор отсекает документы по TopDocuments::IsMoreRelevant, а это строгий полный порядок, поэтому на границе страниц
+    // документы с почти равной релевантностью не теряются и не повторяются
+    template <typename DocumentPredicate>
+    SearchPage FindTopDocumentsPage(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t page_size,
+                                    const std::optional<SearchCursor>& cursor = std::nullopt) const;
+    SearchPage FindTopDocumentsPage(const std::string_view& raw_query, DocumentStatus status, size_t page_size,
+                                    const std::optional<SearchCursor>& cursor = std::nullopt) const;
+    SearchPage FindTopDocumentsPage(const std::string_view& raw_query, size_t page_size,
+                                    const std::optional<SearchCursor>& cursor = std::nullopt) const;
+
+    // Бюджет ограничивает чтение списков документов плюс-слов. Слова обходятся по возрастанию документной частоты,
+    // поэтому редкие слова с большим IDF учитываются первыми и частичный результат ближе к полному
+    template <typename DocumentPredicate>
+    SearchResult FindTopDocumentsWithBudget(const std::string_view& raw_query, const SearchBudget& budget, DocumentPredicate document_predicate,
+                                            size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    SearchResult FindTopDocumentsWithBudget(const std::string_view& raw_query, const SearchBudget& budget, DocumentStatus status,
+                                            size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    SearchResult FindTopDocumentsWithBudget(const std::string_view& raw_query, const SearchBudget& budget) const;
+    // Сколько запросов с бюджетом выполнено и сколько из них вернули частичный результат
+    SearchBudgetStats GetSearchBudgetStats() const;
+
+    PreparedQuery PrepareQuery(std::string_view raw_query) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
+    // Результат пишется в переданный вектор: повторный запрос к неизменному индексу не выделяет память.
+    // Это единственная такая перегрузка: остальные возвращают новый вектор, а при QueryEvaluation::EXHAUSTIVE
+    // или устаревшем запросе поиск идёт через разбор текста и тоже выделяет память
+    template <typename DocumentPredicate>
+    void FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, size_t top_count, std::vector<Document>& result) const;
+
+    void EnableQueryCache(size_t capacity);
+    void DisableQueryCache();
+    QueryCacheStats GetQueryCacheStats() const;
+    uint64_t GetGeneration() const;
+
+    // IDF слов запроса считается по статистике всей коллекции, а не только этого индекса
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsWithStatistics(const CollectionStatistics& statistics, const std::string_view& raw_query,
+                                                         DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    void SetQueryEvaluation(QueryEvaluation query_evaluation);
+    QueryEvaluation GetQueryEvaluation() const;
+
+    void SetPartitionCount(size_t partition_count);
+    size_t GetPartitionCount() const;
+
+    // Разделы по статусам читаются последовательным поиском, пакетным поиском и подготовленными запросами со статусом.
+    // Предикаты общего вида по-прежнему обходят общие списки целиком
+    void SetPostingLayout(PostingLayout posting_layout);
+    PostingLayout GetPostingLayout() const;
+
+    void SetExecutionThresholds(const ExecutionThresholds& thresholds);
+    ExecutionThresholds GetExecutionThresholds() const;
+    // Сколько запросов с AdaptivePolicy выполнено каждой стратегией
+    ExecutionStrategyStats GetExecutionStrategyStats() const;
+
     int GetDocumentCount() const;
 
-    std::set<int>::const_iterator begin() const;
-    std::set<int>::const_iterator end() const;
+    DocumentTable::IdIterator begin() const;
+    DocumentTable::IdIterator end() const;
+
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    std::optional<int> GetTermId(std::string_view word) const;
+    std::string_view GetTerm(int term_id) const;
+    size_t GetTermCount() const;
+    int GetDocumentFrequency(std::string_view word) const;
+    std::optional<TermStatistics> GetTermStatistics(std::string_view word) const;
+    // Статистика всех терминов индекса в порядке их идентификаторов
+    std::vector<TermStatistics> GetCorpusStatistics() const;
+
+    void SetDuplicatePolicy(DuplicatePolicy duplicate_policy);
+    DuplicatePolicy GetDuplicatePolicy() const;
+    std::optional<Fingerprint> GetFingerprint(int document_id) const;
+    // Документ с наименьшим идентификатором и тем же набором слов, не считая самого document_id
+    std::optional<int> FindDuplicate(int document_id) const;
+    // Документы, набор слов которых уже есть у документа с меньшим идентификатором, по возрастанию идентификаторов
+    template <typename ExecutionPolicy>
+    std::vector<int> FindDuplicates(const ExecutionPolicy& policy) const;
+    std::vector<int> FindDuplicates() const;
 
     template <typename ExecutionPolicy>
     void RemoveDocument(const ExecutionPolicy& policy, int document_id);
     void RemoveDocument(int document_id);
+    // Неизвестные идентификаторы пропускаются. Удаления группируются по терминам, и каждый список документов меняет одна задача
+    template <typename ExecutionPolicy>
+    void RemoveDocuments(const ExecutionPolicy& policy, const std::vector<int>& document_ids);
+    void RemoveDocuments(const std::vector<int>& document_ids);
 
     template <typename ExecutionPolicy, typename QueryType>
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const ExecutionPolicy& policy, const QueryType& raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view& raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const PreparedQuery& query, int document_id) const;
+
+    void SaveSnapshot(const std::string& path) const;
+    // Массивы и таблицы поиска снимка читаются прямо из отображённой памяти, поэтому загрузка не зависит от размера коллекции.
+    // Первое изменение загруженного индекса копирует затронутые структуры
+    static SearchServer LoadSnapshot(const std::string& path, SnapshotVerification verification = SnapshotVerification::HEADER);
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-    };
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_frequency_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    std::deque<std::string> words_;
+    std::set<std::string, std::less<>> stop_words_;
+    TermDictionary terms_;
+    std::vector<PostingList> word_to_document_freqs_;
+    ForwardIndex document_to_word_frequency_;
+    DocumentTable documents_;
+    std::shared_ptr<const MappedFile> snapshot_file_;
+    QueryEvaluation query_evaluation_ = QueryEvaluation::MAX_SCORE;
+    size_t partition_count_ = std::max(1u, std::thread::hardware_concurrency());
+    static constexpr size_t batch_block_size_ = 64;
+    ExecutionThresholds execution_thresholds_;
+    std::unique_ptr<ExecutionStrategyCounter> execution_strategy_counter_ = std::make_unique<ExecutionStrategyCounter>();
+    std::unique_ptr<SearchBudgetCounter> search_budget_counter_ = std::make_unique<SearchBudgetCounter>();
+    DuplicatePolicy duplicate_policy_ = DuplicatePolicy::ALLOW;
+    PostingLayout posting_layout_ = PostingLayout::ORDINAL;
+    std::unique_ptr<StatusPostings> status_postings_;
+    uint64_t generation_ = 0;
+    // Уникален для каждого созданного или скопированного сервера, ноль не выдаётся
+    uint64_t instance_id_ = MakeInstanceId();
+    std::unique_ptr<QueryCache> query_cache_;
+    std::unique_ptr<IdfTable> idf_table_ = std::make_unique<IdfTable>();
+
+    static uint64_t MakeInstanceId();
+    // Термины и IDF подготовленного запроса годятся, только если он разобран этим сервером на текущем поколении
+    bool IsPreparedHere(const PreparedQuery& query) const;
 
     bool IsStopWord(const std::string_view& word) const;
 
@@ -75,6 +261,27 @@ private:
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    struct ParsedDocument {
+        std::map<std::string_view, double> word_freqs;
+        Fingerprint fingerprint;
+        std::string error;
+    };
+    ParsedDocument ParseDocument(const RawDocument& document) const;
+    void CheckDocuments(const std::vector<RawDocument>& documents, const std::vector<ParsedDocument>& parsed_documents) const;
+
+    static Fingerprint ComputeFingerprint(const std::vector<std::string_view>& words);
+    std::optional<int> FindDocumentWithFingerprint(Fingerprint fingerprint, int excluded_document_id = -1) const;
+    void CheckDuplicate(int document_id, Fingerprint fingerprint) const;
+
+    int GetOrdinalForUpdate(int document_id) const;
+    void EraseTermPosting(int term_id, int ordinal);
+    void AddStatusPostings(int ordinal);
+    void EraseStatusPostings(int ordinal);
+    // Изменение, не затрагивающее частоты слов и число документов, сохраняет таблицу IDF
+    void BumpGenerationKeepingIdf();
+
+    using PartialIndex = std::unordered_map<std::string_view, std::vector<std::pair<int, double>>>;
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
@@ -94,12 +301,75 @@ private:
     };
     QueryParPolicy ParseQueryParPolicy(const std::string_view& text) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+    bool IsWordInDocument(std::string_view word, int ordinal) const;
+
+    void RemoveDocumentData(const std::vector<int>& ordinals);
+    void CompactDocuments();
+
+    double ComputeWordInverseDocumentFreq(int term_id, const CollectionStatistics* statistics = nullptr) const;
+
+    template <typename DocumentPredicate>
+    std::map<int, double> FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                           const CollectionStatistics* statistics = nullptr) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsMaxScore(const Query& query, DocumentPredicate document_predicate, size_t top_count,
+                                                   const CollectionStatistics* statistics = nullptr) const;
+
+    struct ScoredTerm {
+        const PostingList* postings = nullptr;
+        double inverse_document_freq = 0.0;
+    };
+    using ScoredTerms = SmallVector<ScoredTerm, 16>;
+    using MinusPostings = SmallVector<const PostingList*, 16>;
+    // Идентификатор термина и его IDF
+    using TermWeights = SmallVector<std::pair<int, double>, 16>;
+
+    std::vector<Document> FindTopDocumentsInStatus(const TermWeights& plus_terms, const MinusPostings& minus_postings, DocumentStatus status,
+                                                   size_t top_count) const;
+    std::vector<Document> FindTopDocumentsInStatus(const Query& query, DocumentStatus status, size_t top_count) const;
+    std::vector<Document> FindTopDocumentsByImpact(const ImpactPostingList& postings, double inverse_document_freq,
+                                                   const MinusPostings& minus_postings, size_t top_count) const;
+
+    template <typename DocumentPredicate>
+    void ScoreMaxScore(const ScoredTerms& plus_terms, const MinusPostings& minus_postings, DocumentPredicate document_predicate,
+                       TopDocuments& top_documents) const;
+
+    template <typename DocumentPredicate>
+    SearchPage ScorePage(const ScoredTerms& plus_terms, const MinusPostings& minus_postings, DocumentPredicate document_predicate,
+                         size_t page_size, const std::optional<SearchCursor>& cursor) const;
+
+    template <typename DocumentPredicate>
+    SearchResult ScoreWithinBudget(ScoredTerms plus_terms, const MinusPostings& minus_postings, const SearchBudget& budget,
+                                   DocumentPredicate document_predicate, size_t top_count) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPartitioned(const ExecutionPolicy& policy, const QueryParPolicy& query, DocumentPredicate document_predicate,
+                                                      size_t top_count) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsAdaptive(const AdaptivePolicy& policy, const Query& query, DocumentPredicate document_predicate,
+                                                   size_t top_count) const;
+    // Поиск по уже разобранному запросу, чтобы кэширующие обёртки не разбирали текст второй раз
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsParsed(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate,
+                                                 size_t top_count) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsByTerm(ThreadPool& pool, const Query& query, DocumentPredicate document_predicate, size_t top_count) const;
+
+    template <typename DocumentPredicate>
+    std::vector<std::vector<Document>> FindTopDocumentsShared(const std::vector<Query>& queries, DocumentPredicate document_predicate,
+                                                              size_t top_count, std::optional<DocumentStatus> status = std::nullopt) const;
+
+    std::vector<Document> SelectTopDocuments(const std::map<int, double>& document_to_relevance, size_t top_count) const;
+    std::vector<Document> SelectTopDocuments(const ScoreAccumulator& document_to_relevance, const MinusPostings& minus_postings, size_t top_count) const;
 
-    template <typename DocumentPredicate, typename QueryType, typename ExecutionPolicy>
-    std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const QueryType& query, DocumentPredicate document_predicate) const;
-    template <typename DocumentPredicate, typename QueryType>
-    std::vector<Document> FindAllDocuments(const QueryType& query, DocumentPredicate document_predicate) const;
+    std::string MakeQueryCacheKey(const Query& query, const std::string& predicate_key, size_t top_count) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsCached(const ExecutionPolicy& policy, const std::string_view& raw_query, const std::string& predicate_key,
+                                                 DocumentPredicate document_predicate, size_t top_count,
+                                                 std::optional<DocumentStatus> status = std::nullopt) const;
 };
 
 template <typename StringContainer>
@@ -110,39 +380,133 @@ SearchServer::SearchServer(const StringContainer& stop_words)
     }
 }
 
+template <typename ExecutionPolicy>
+void SearchServer::AddDocuments(const ExecutionPolicy& policy, const std::vector<RawDocument>& documents) {
+    std::vector<ParsedDocument> parsed_documents(documents.size());
+    ParallelFor(policy, documents.size(), [&](size_t index) {
+        parsed_documents[index] = ParseDocument(documents[index]);
+    });
+    // До этой проверки индекс не меняется, поэтому ошибка в любом документе оставляет сервер нетронутым
+    CheckDocuments(documents, parsed_documents);
+
+    size_t chunk_count = 1;
+    if constexpr (!std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        chunk_count = std::max<size_t>(1, std::min(partition_count_, documents.size()));
+    }
+    std::vector<PartialIndex> partial_indexes(chunk_count);
+    ParallelFor(policy, chunk_count, [&](size_t chunk) {
+        const size_t first = documents.size() * chunk / chunk_count;
+        const size_t last = documents.size() * (chunk + 1) / chunk_count;
+        auto& partial_index = partial_indexes[chunk];
+        for (size_t index = first; index < last; ++index) {
+            for (const auto [word, term_freq] : parsed_documents[index].word_freqs) {
+                partial_index[word].push_back({static_cast<int>(index), term_freq});
+            }
+        }
+    });
+
+    const int first_ordinal = static_cast<int>(documents_.GetOrdinalBound());
+    std::unordered_map<int, std::vector<std::pair<int, double>>> term_to_postings;
+    for (const auto& partial_index : partial_indexes) {
+        for (const auto& [word, postings] : partial_index) {
+            auto& term_postings = term_to_postings[terms_.Intern(word)];
+            for (const auto& [index, term_freq] : postings) {
+                term_postings.push_back({first_ordinal + index, term_freq});
+            }
+        }
+    }
+    if (word_to_document_freqs_.size() < terms_.GetIdBound()) {
+        word_to_document_freqs_.resize(terms_.GetIdBound());
+    }
+    if (status_postings_) {
+        status_postings_->Resize(terms_.GetIdBound());
+    }
+    std::vector<std::pair<int, std::vector<std::pair<int, double>>>> new_postings(
+                std::make_move_iterator(term_to_postings.begin()), std::make_move_iterator(term_to_postings.end()));
+    ParallelFor(policy, new_postings.size(), [&](size_t index) {
+        const auto& [term_id, term_postings] = new_postings[index];
+        auto& postings = word_to_document_freqs_[term_id];
+        for (const auto& [ordinal, term_freq] : term_postings) {
+            postings.Insert(ordinal, term_freq);
+        }
+        if (status_postings_) {
+            for (const auto& [ordinal, term_freq] : term_postings) {
+                status_postings_->Insert(term_id, documents[ordinal - first_ordinal].status, ordinal, term_freq);
+            }
+            status_postings_->Flush(term_id);
+        }
+    });
+
+    std::vector<std::vector<TermFrequency>> term_freqs(documents.size());
+    ParallelFor(policy, parsed_documents.size(), [&](size_t index) {
+        auto& result = term_freqs[index];
+        result.reserve(parsed_documents[index].word_freqs.size());
+        for (const auto [word, term_freq] : parsed_documents[index].word_freqs) {
+            result.push_back({*terms_.Find(word), term_freq});
+        }
+        std::sort(result.begin(), result.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+            return lhs.term_id < rhs.term_id;
+        });
+    });
+    for (size_t index = 0; index < documents.size(); ++index) {
+        const RawDocument& document = documents[index];
+        documents_.Add(document.id, document.status, ComputeAverageRating(document.ratings), parsed_documents[index].fingerprint);
+        document_to_word_frequency_.Add(std::move(term_freqs[index]));
+    }
+    if (!documents.empty()) {
+        ++generation_;
+    }
+}
+
 template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const {
-    std::vector<Document> matched_documents;
-    if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                     size_t top_count) const {
+    INSTRUMENT_SEARCH_QUERY();
+    if constexpr (std::is_same_v<ExecutionPolicy, AdaptivePolicy>) {
+        return FindTopDocumentsAdaptive(policy, ParseQuery(raw_query), document_predicate, top_count);
+    } else if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
         const auto query = ParseQuery(raw_query);
-        matched_documents = FindAllDocuments(query, document_predicate);
+        if (query_evaluation_ == QueryEvaluation::MAX_SCORE) {
+            return FindTopDocumentsMaxScore(query, document_predicate, top_count);
+        }
+        return SelectTopDocuments(FindAllDocuments(query, document_predicate), top_count);
     } else {
         const auto query = ParseQueryParPolicy(raw_query);
-        matched_documents = FindAllDocuments(policy, query, document_predicate);
-    }
-    sort(matched_documents.begin(), matched_documents.end(),
-         [](const Document& lhs, const Document& rhs) {
-        const double EPSILON = 1e-6;
-        return lhs.relevance > rhs.relevance
-                || (std::abs(lhs.relevance - rhs.relevance) < EPSILON && lhs.rating > rhs.rating);
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        return FindTopDocumentsPartitioned(policy, query, document_predicate, top_count);
     }
-    return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, top_count);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsParsed(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate,
+                                                           size_t top_count) const {
+    if constexpr (std::is_same_v<ExecutionPolicy, AdaptivePolicy>) {
+        return FindTopDocumentsAdaptive(policy, query, document_predicate, top_count);
+    } else if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        if (query_evaluation_ == QueryEvaluation::MAX_SCORE) {
+            return FindTopDocumentsMaxScore(query, document_predicate, top_count);
+        }
+        return SelectTopDocuments(FindAllDocuments(query, document_predicate), top_count);
+    } else {
+        // Слова в множествах уже упорядочены и не повторяются, как после ParseQueryParPolicy
+        return FindTopDocumentsPartitioned(policy,
+                                           QueryParPolicy{{query.plus_words.begin(), query.plus_words.end()},
+                                                          {query.minus_words.begin(), query.minus_words.end()}},
+                                           document_predicate, top_count);
+    }
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query,
-                            [status](int document_id, DocumentStatus document_status, int rating) {
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status,
+                                                     size_t top_count) const {
+    return FindTopDocumentsCached(policy, raw_query, "status "s + std::to_string(static_cast<int>(status)),
+                                  [status](int document_id, DocumentStatus document_status, int rating) {
         return document_status == status;
-    });
+    }, top_count, status);
 }
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query) const {
@@ -150,29 +514,306 @@ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& poli
 
 }
 
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, QueryCacheTag cache_tag,
+                                                     DocumentPredicate document_predicate, size_t top_count) const {
+    return FindTopDocumentsCached(policy, raw_query, "tag "s + std::string(cache_tag.name), document_predicate, top_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, QueryCacheTag cache_tag,
+                                                     DocumentPredicate document_predicate, size_t top_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, cache_tag, document_predicate, top_count);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsCached(const ExecutionPolicy& policy, const std::string_view& raw_query, const std::string& predicate_key,
+                                                           DocumentPredicate document_predicate, size_t top_count,
+                                                           std::optional<DocumentStatus> status) const {
+    INSTRUMENT_SEARCH_QUERY();
+    // Запрос разбирается один раз: по нему строится ключ кэша и при промахе выполняется поиск
+    const auto query = ParseQuery(raw_query);
+    const auto find_top_documents = [&] {
+        if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+            if (status && status_postings_) {
+                return FindTopDocumentsInStatus(query, *status, top_count);
+            }
+        }
+        return FindTopDocumentsParsed(policy, query, document_predicate, top_count);
+    };
+    if (!query_cache_) {
+        return find_top_documents();
+    }
+    std::string key = MakeQueryCacheKey(query, predicate_key, top_count);
+    if (auto documents = query_cache_->Find(key, generation_)) {
+        return std::move(*documents);
+    }
+    auto documents = find_top_documents();
+    query_cache_->Insert(std::move(key), generation_, documents);
+    return documents;
+}
+
+template <typename ExecutionPolicy, typename ResultHandler>
+void SearchServer::FindTopDocumentsBatch(const ExecutionPolicy& policy, const std::vector<std::string>& raw_queries, DocumentStatus status,
+                                         ResultHandler handle_result) const {
+    const auto document_predicate = [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    };
+    const std::string predicate_key = "status "s + std::to_string(static_cast<int>(status));
+    // Блоки одного раунда обрабатываются параллельно, поэтому в памяти одновременно лежат только результаты раунда
+    const size_t round_size = batch_block_size_ * partition_count_;
+    std::vector<std::vector<Document>> documents_lists;
+    for (size_t round_begin = 0; round_begin < raw_queries.size(); round_begin += round_size) {
+        const size_t round_end = std::min(raw_queries.size(), round_begin + round_size);
+        documents_lists.assign(round_end - round_begin, {});
+        const size_t block_count = (round_end - round_begin + batch_block_size_ - 1) / batch_block_size_;
+        ParallelFor(policy, block_count, [&](size_t block) {
+            const size_t block_begin = round_begin + block * batch_block_size_;
+            const size_t block_end = std::min(round_end, block_begin + batch_block_size_);
+            std::vector<Query> queries;
+            std::vector<size_t> query_indexes;
+            std::vector<std::string> keys;
+            for (size_t i = block_begin; i < block_end; ++i) {
+                Query query = ParseQuery(raw_queries[i]);
+                if (query_cache_) {
+                    std::string key = MakeQueryCacheKey(query, predicate_key, MAX_RESULT_DOCUMENT_COUNT);
+                    if (auto documents = query_cache_->Find(key, generation_)) {
+                        documents_lists[i - round_begin] = std::move(*documents);
+                        continue;
+                    }
+                    keys.push_back(std::move(key));
+                }
+                queries.push_back(std::move(query));
+                query_indexes.push_back(i);
+            }
+            auto block_documents_lists = FindTopDocumentsShared(queries, document_predicate, MAX_RESULT_DOCUMENT_COUNT, status);
+            for (size_t i = 0; i < query_indexes.size(); ++i) {
+                if (query_cache_) {
+                    query_cache_->Insert(std::move(keys[i]), generation_, block_documents_lists[i]);
+                }
+                documents_lists[query_indexes[i] - round_begin] = std::move(block_documents_lists[i]);
+            }
+        });
+        for (size_t i = 0; i < documents_lists.size(); ++i) {
+            handle_result(round_begin + i, std::move(documents_lists[i]));
+        }
+    }
+}
+
+template <typename DocumentPredicate>
+SearchPage SearchServer::FindTopDocumentsPage(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t page_size,
+                                              const std::optional<SearchCursor>& cursor) const {
+    INSTRUMENT_SEARCH_QUERY();
+    const auto query = ParseQuery(raw_query);
+    ScoredTerms plus_terms;
+    for (const std::string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            plus_terms.push_back({&word_to_document_freqs_[*term_id], ComputeWordInverseDocumentFreq(*term_id)});
+        }
+    }
+    MinusPostings minus_postings;
+    for (const std::string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            minus_postings.push_back(&word_to_document_freqs_[*term_id]);
+        }
+    }
+    return ScorePage(plus_terms, minus_postings, document_predicate, page_size, cursor);
+}
+
+template <typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocumentsWithBudget(const std::string_view& raw_query, const SearchBudget& budget, DocumentPredicate document_predicate,
+                                                      size_t top_count) const {
+    INSTRUMENT_SEARCH_QUERY();
+    const auto query = ParseQuery(raw_query);
+    ScoredTerms plus_terms;
+    for (const std::string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            plus_terms.push_back({&word_to_document_freqs_[*term_id], ComputeWordInverseDocumentFreq(*term_id)});
+        }
+    }
+    MinusPostings minus_postings;
+    for (const std::string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            minus_postings.push_back(&word_to_document_freqs_[*term_id]);
+        }
+    }
+    return ScoreWithinBudget(std::move(plus_terms), minus_postings, budget, document_predicate, top_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, size_t top_count) const {
+    std::vector<Document> result;
+    FindTopDocuments(query, document_predicate, top_count, result);
+    return result;
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, size_t top_count,
+                                    std::vector<Document>& result) const {
+    INSTRUMENT_SEARCH_QUERY();
+    if (!IsPreparedHere(query)) {
+        // Идентификаторы терминов и IDF устарели, поэтому запрос разбирается заново
+        FindTopDocuments(PrepareQuery(query.GetText()), document_predicate, top_count, result);
+        return;
+    }
+    if (query_evaluation_ == QueryEvaluation::EXHAUSTIVE) {
+        result = FindTopDocuments(std::execution::seq, query.GetText(), document_predicate, top_count);
+        return;
+    }
+    ScoredTerms plus_terms;
+    for (const auto& term : query.plus_terms_) {
+        plus_terms.push_back({&word_to_document_freqs_[term.term_id], term.inverse_document_freq});
+    }
+    MinusPostings minus_postings;
+    for (const auto& term : query.minus_terms_) {
+        minus_postings.push_back(&word_to_document_freqs_[term.term_id]);
+    }
+    TopDocuments top_documents(top_count, std::move(result));
+    ScoreMaxScore(plus_terms, minus_postings, document_predicate, top_documents);
+    result = top_documents.Extract();
+}
+
+template <typename ExecutionPolicy>
+std::vector<int> SearchServer::FindDuplicates(const ExecutionPolicy& policy) const {
+    // Документы раскладываются по корзинам по отпечатку, поэтому каждую корзину можно проверить независимо
+    using Entry = std::pair<Fingerprint, int>;
+    const size_t ordinal_bound = documents_.GetOrdinalBound();
+    const size_t partition_count = std::max<size_t>(1, std::min(partition_count_, ordinal_bound));
+    std::vector<std::vector<std::vector<Entry>>> partition_buckets(partition_count, std::vector<std::vector<Entry>>(partition_count));
+    ParallelFor(policy, partition_count, [&](size_t partition) {
+        auto& buckets = partition_buckets[partition];
+        const size_t first_ordinal = ordinal_bound * partition / partition_count;
+        const size_t last_ordinal = ordinal_bound * (partition + 1) / partition_count;
+        for (size_t ordinal = first_ordinal; ordinal < last_ordinal; ++ordinal) {
+            const int document_id = documents_.GetDocumentId(ordinal);
+            if (document_id >= 0) {
+                const Fingerprint fingerprint = documents_.GetFingerprint(ordinal);
+                buckets[fingerprint.high % partition_count].push_back({fingerprint, document_id});
+            }
+        }
+    });
+
+    std::vector<std::vector<int>> bucket_duplicates(partition_count);
+    ParallelFor(policy, partition_count, [&](size_t bucket) {
+        std::vector<Entry> entries;
+        for (const auto& buckets : partition_buckets) {
+            entries.insert(entries.end(), buckets[bucket].begin(), buckets[bucket].end());
+        }
+        std::sort(entries.begin(), entries.end());
+        for (size_t i = 1; i < entries.size(); ++i) {
+            if (entries[i].first == entries[i - 1].first) {
+                bucket_duplicates[bucket].push_back(entries[i].second);
+            }
+        }
+    });
+
+    std::vector<int> duplicates;
+    for (const auto& ids : bucket_duplicates) {
+        duplicates.insert(duplicates.end(), ids.begin(), ids.end());
+    }
+    std::sort(duplicates.begin(), duplicates.end());
+    return duplicates;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWithStatistics(const CollectionStatistics& statistics, const std::string_view& raw_query,
+                                                                   DocumentPredicate document_predicate, size_t top_count) const {
+    const auto query = ParseQuery(raw_query);
+    if (query_evaluation_ == QueryEvaluation::MAX_SCORE) {
+        return FindTopDocumentsMaxScore(query, document_predicate, top_count, &statistics);
+    }
+    return SelectTopDocuments(FindAllDocuments(query, document_predicate, &statistics), top_count);
+}
+
 template <typename ExecutionPolicy>
 void SearchServer::RemoveDocument(const ExecutionPolicy& policy, int document_id) {
     if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
         RemoveDocument(document_id);
     } else {
-        if (documents_.count(document_id) != 0){
-            std::vector<const std::string_view*> words_to_delete(document_to_word_frequency_.at(document_id).size());
-            std::transform (policy,
-                            document_to_word_frequency_[document_id].begin(), document_to_word_frequency_[document_id].end(),
-                            words_to_delete.begin(),
-                            [] (const auto& x) {
-                return &x.first;
-            });
-            std::for_each(policy,
-                          words_to_delete.begin(), words_to_delete.end(),
-                          [this, &document_id](const auto word){
-                word_to_document_freqs_[*word].erase(document_id);
-            });
-            document_to_word_frequency_.erase(document_id);
-            documents_.erase(document_id);
-            document_ids_.erase(document_id);
+        RemoveDocuments(policy, {document_id});
+    }
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocuments(const ExecutionPolicy& policy, const std::vector<int>& document_ids) {
+    std::vector<int> ordinals;
+    ordinals.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        if (const auto ordinal = documents_.FindOrdinal(document_id)) {
+            ordinals.push_back(*ordinal);
+        }
+    }
+    std::sort(ordinals.begin(), ordinals.end());
+    ordinals.erase(std::unique(ordinals.begin(), ordinals.end()), ordinals.end());
+    if (ordinals.empty()) {
+        return;
+    }
+
+    // Пары (термин, документ) раскладываются по корзинам по термину, поэтому каждый список документов меняется только в одной задаче
+    using Entry = std::pair<int, int>;
+    size_t partition_count = 1;
+    if constexpr (!std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        partition_count = std::max<size_t>(1, std::min(partition_count_, ordinals.size()));
+    }
+    std::vector<std::vector<std::vector<Entry>>> partition_buckets(partition_count, std::vector<std::vector<Entry>>(partition_count));
+    ParallelFor(policy, partition_count, [&](size_t partition) {
+        auto& buckets = partition_buckets[partition];
+        const size_t first = ordinals.size() * partition / partition_count;
+        const size_t last = ordinals.size() * (partition + 1) / partition_count;
+        for (size_t index = first; index < last; ++index) {
+            for (const auto [term_id, _] : document_to_word_frequency_.Get(ordinals[index])) {
+                buckets[term_id % partition_count].push_back({term_id, ordinals[index]});
+            }
+        }
+    });
+
+    std::vector<std::vector<int>> bucket_empty_terms(partition_count);
+    ParallelFor(policy, partition_count, [&](size_t bucket) {
+        std::vector<Entry> entries;
+        for (const auto& buckets : partition_buckets) {
+            entries.insert(entries.end(), buckets[bucket].begin(), buckets[bucket].end());
+        }
+        std::sort(entries.begin(), entries.end());
+        std::vector<int> term_ordinals;
+        std::array<std::vector<int>, DOCUMENT_STATUS_COUNT> status_ordinals;
+        for (size_t first = 0; first < entries.size();) {
+            const int term_id = entries[first].first;
+            term_ordinals.clear();
+            size_t last = first;
+            for (; last < entries.size() && entries[last].first == term_id; ++last) {
+                term_ordinals.push_back(entries[last].second);
+            }
+            auto& postings = word_to_document_freqs_[term_id];
+            postings.Erase(term_ordinals);
+            if (status_postings_) {
+                for (auto& ordinals_of_status : status_ordinals) {
+                    ordinals_of_status.clear();
+                }
+                for (const int ordinal : term_ordinals) {
+                    status_ordinals[static_cast<size_t>(documents_.GetStatus(ordinal))].push_back(ordinal);
+                }
+                for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+                    if (!status_ordinals[status].empty()) {
+                        status_postings_->Erase(term_id, static_cast<DocumentStatus>(status), status_ordinals[status]);
+                    }
+                }
+            }
+            if (postings.empty()) {
+                postings = PostingList();
+                if (status_postings_) {
+                    status_postings_->Clear(term_id);
+                }
+                bucket_empty_terms[bucket].push_back(term_id);
+            }
+            first = last;
+        }
+    });
+    for (const auto& empty_terms : bucket_empty_terms) {
+        for (const int term_id : empty_terms) {
+            terms_.Erase(term_id);
         }
     }
+    RemoveDocumentData(ordinals);
 }
 
 template <typename ExecutionPolicy, typename QueryType>
@@ -180,86 +821,421 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
         return MatchDocument(raw_query, document_id);
     } else {
+        // Слова запроса уже отсортированы и уникальны, поэтому параллельно выполняются только проверки вхождения
         const auto query = ParseQueryParPolicy(raw_query);
-        std::vector<std::string_view> matched_words(query.plus_words.size());
-        auto& status = documents_.at(document_id).status;
-        const auto word_checker = [this, document_id](std::string_view word_view) {
-            const auto& item = word_to_document_freqs_.find(word_view);
-            return item != word_to_document_freqs_.end() && item->second.count(document_id);
-        };
-        if (any_of(policy, query.minus_words.begin(), query.minus_words.end(), word_checker)) {
+        std::vector<std::string_view> matched_words;
+        const int ordinal = documents_.GetOrdinal(document_id);
+        const DocumentStatus status = documents_.GetStatus(ordinal);
+        std::vector<std::string_view> words = query.minus_words;
+        words.insert(words.end(), query.plus_words.begin(), query.plus_words.end());
+        std::vector<char> is_in_document(words.size());
+        ParallelFor(policy, words.size(), [&](size_t index) {
+            is_in_document[index] = IsWordInDocument(words[index], ordinal);
+        });
+        const auto plus_begin = is_in_document.begin() + query.minus_words.size();
+        if (std::find(is_in_document.begin(), plus_begin, 1) != plus_begin) {
             return make_tuple(matched_words, status);
         }
-        auto matched_words_end = std::copy_if(policy,
-                                              query.plus_words.begin(), query.plus_words.end(),
-                                              matched_words.begin(),
-                                              word_checker);
-        matched_words.erase(matched_words_end, matched_words.end());
-
-        sort(policy, matched_words.begin(), matched_words.end());
-        auto last = unique(policy, matched_words.begin(), matched_words.end());
-        matched_words.erase(last, matched_words.end());
-
+        for (size_t i = 0; i < query.plus_words.size(); ++i) {
+            if (plus_begin[i]) {
+                matched_words.push_back(query.plus_words[i]);
+            }
+        }
         return make_tuple(matched_words, status);
     }
 }
 
-template <typename DocumentPredicate, typename QueryType, typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const QueryType& query, DocumentPredicate document_predicate) const {
+template <typename DocumentPredicate>
+std::map<int, double> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                     const CollectionStatistics* statistics) const {
     std::map<int, double> document_to_relevance;
-    if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+    {
+        INSTRUMENT_SEARCH_STAGE(POSTING_TRAVERSAL);
+        INSTRUMENT_SAMPLED_STAGE(predicate_stage, PREDICATE);
         for (const std::string_view& word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
+            const auto term_id = terms_.Find(word);
+            if (!term_id) {
                 continue;
             }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(*term_id, statistics);
+            const auto& postings = word_to_document_freqs_[*term_id];
+            for (const auto [ordinal, term_freq] : postings) {
+                if (INSTRUMENT_SAMPLED_CALL(predicate_stage, document_predicate(documents_.GetDocumentId(ordinal), documents_.GetStatus(ordinal),
+                                                                                 documents_.GetRating(ordinal)))) {
+                    document_to_relevance[ordinal] += term_freq * inverse_document_freq;
                 }
             }
+            INSTRUMENT_SEARCH_COUNT(POSTINGS_VISITED, postings.size());
         }
-        for (const std::string_view& word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
+        INSTRUMENT_SEARCH_COUNT(DOCUMENTS_SCORED, document_to_relevance.size());
+    }
+    INSTRUMENT_SEARCH_STAGE(MINUS_WORDS);
+    for (const std::string_view& word : query.minus_words) {
+        const auto term_id = terms_.Find(word);
+        if (!term_id) {
+            continue;
+        }
+        for (const auto [ordinal, _] : word_to_document_freqs_[*term_id]) {
+            document_to_relevance.erase(ordinal);
+        }
+    }
+    return document_to_relevance;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsMaxScore(const Query& query, DocumentPredicate document_predicate, size_t top_count,
+                                                             const CollectionStatistics* statistics) const {
+    ScoredTerms plus_terms;
+    for (const std::string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            plus_terms.push_back({&word_to_document_freqs_[*term_id], ComputeWordInverseDocumentFreq(*term_id, statistics)});
+        }
+    }
+    MinusPostings minus_postings;
+    for (const std::string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            minus_postings.push_back(&word_to_document_freqs_[*term_id]);
+        }
+    }
+    TopDocuments top_documents(top_count);
+    ScoreMaxScore(plus_terms, minus_postings, document_predicate, top_documents);
+    return top_documents.Extract();
+}
+
+template <typename DocumentPredicate>
+void SearchServer::ScoreMaxScore(const ScoredTerms& plus_terms, const MinusPostings& minus_postings, DocumentPredicate document_predicate,
+                                 TopDocuments& top_documents) const {
+    constexpr int NO_DOCUMENT = std::numeric_limits<int>::max();
+    struct TermCursor {
+        PostingList::const_iterator current;
+        PostingList::const_iterator end;
+        double inverse_document_freq = 0.0;
+        double upper_bound = 0.0;
+        int ordinal = NO_DOCUMENT;
+        double term_freq = 0.0;
+
+        void Load() {
+            if (current != end) {
+                INSTRUMENT_SEARCH_COUNT(POSTINGS_VISITED, 1);
+                std::tie(ordinal, term_freq) = *current;
+            } else {
+                ordinal = NO_DOCUMENT;
             }
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+        }
+        void SkipTo(int target) {
+            if (ordinal < target) {
+                current.Seek(target);
+                Load();
             }
         }
-    } else {
-        ConcurrentMap<int, double> c_document_to_relevance(1000);
-        for_each(policy,
-                 query.plus_words.begin(), query.plus_words.end(),
-                 [this, &c_document_to_relevance, &document_predicate] (const auto& word) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    c_document_to_relevance[document_id].ref_to_value += (term_freq * inverse_document_freq);
+        void Next() {
+            ++current;
+            Load();
+        }
+    };
+    INSTRUMENT_SEARCH_STAGE(POSTING_TRAVERSAL);
+    INSTRUMENT_SAMPLED_STAGE(predicate_stage, PREDICATE);
+    INSTRUMENT_SAMPLED_STAGE(minus_words_stage, MINUS_WORDS);
+    INSTRUMENT_SAMPLED_STAGE(top_k_stage, TOP_K);
+    // Курсоры идут в порядке слов запроса, чтобы релевантность суммировалась так же, как в полном переборе
+    SmallVector<TermCursor, 16> cursors;
+    for (const auto& [postings, inverse_document_freq] : plus_terms) {
+        cursors.push_back({postings->begin(), postings->end(), inverse_document_freq, postings->GetMaxTermFreq() * inverse_document_freq});
+        cursors[cursors.size() - 1].Load();
+    }
+
+    SmallVector<size_t, 16> order;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&cursors](size_t lhs, size_t rhs) {
+        return cursors[lhs].upper_bound < cursors[rhs].upper_bound;
+    });
+    SmallVector<double, 17> prefix_upper_bounds;
+    prefix_upper_bounds.push_back(0.0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        prefix_upper_bounds.push_back(prefix_upper_bounds[i] + cursors[order[i]].upper_bound);
+    }
+
+    // Документ, встречающийся только в неосновных списках, не может попасть в топ
+    size_t first_essential = 0;
+    const auto can_enter_top = [&top_documents](double upper_bound) {
+        return !top_documents.IsFull() || upper_bound > top_documents.GetWorst().relevance - RELEVANCE_EPSILON;
+    };
+    while (top_documents.GetCapacity() > 0) {
+        int ordinal = NO_DOCUMENT;
+        double upper_bound = prefix_upper_bounds[first_essential];
+        for (size_t i = first_essential; i < order.size(); ++i) {
+            const auto& cursor = cursors[order[i]];
+            if (cursor.ordinal < ordinal) {
+                ordinal = cursor.ordinal;
+                upper_bound = prefix_upper_bounds[first_essential] + cursor.upper_bound;
+            } else if (cursor.ordinal == ordinal) {
+                upper_bound += cursor.upper_bound;
+            }
+        }
+        if (ordinal == NO_DOCUMENT) {
+            break;
+        }
+
+        const int document_id = documents_.GetDocumentId(ordinal);
+        const int rating = documents_.GetRating(ordinal);
+        if (can_enter_top(upper_bound)
+                && INSTRUMENT_SAMPLED_CALL(predicate_stage, document_predicate(document_id, documents_.GetStatus(ordinal), rating))) {
+            const bool has_minus_word = INSTRUMENT_SAMPLED_CALL(minus_words_stage, std::any_of(minus_postings.begin(), minus_postings.end(),
+                                                                                               [ordinal](const PostingList* postings) {
+                return postings->Contains(ordinal);
+            }));
+            if (!has_minus_word) {
+                double relevance = 0.0;
+                for (auto& cursor : cursors) {
+                    cursor.SkipTo(ordinal);
+                    if (cursor.ordinal == ordinal) {
+                        relevance += cursor.term_freq * cursor.inverse_document_freq;
+                    }
+                }
+                INSTRUMENT_SEARCH_COUNT(DOCUMENTS_SCORED, 1);
+                INSTRUMENT_SAMPLED_CALL(top_k_stage, top_documents.Add({document_id, relevance, rating}));
+                first_essential = 0;
+                while (first_essential < order.size() && !can_enter_top(prefix_upper_bounds[first_essential + 1])) {
+                    ++first_essential;
                 }
             }
-        });
-        document_to_relevance = c_document_to_relevance.BuildOrdinaryMap();
-        for_each(policy,
-                 query.minus_words.begin(), query.minus_words.end(),
-                 [this, &document_to_relevance](const auto& word) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+        }
+
+        for (size_t i = first_essential; i < order.size(); ++i) {
+            auto& cursor = cursors[order[i]];
+            cursor.SkipTo(ordinal);
+            if (cursor.ordinal == ordinal) {
+                cursor.Next();
             }
-        });
+        }
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsAdaptive(const AdaptivePolicy& policy, const Query& query, DocumentPredicate document_predicate,
+                                                             size_t top_count) const {
+    size_t cost = 0;
+    size_t max_term_cost = 0;
+    for (const std::string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            const size_t term_cost = word_to_document_freqs_[*term_id].size();
+            cost += term_cost;
+            max_term_cost = std::max(max_term_cost, term_cost);
+        }
+    }
+    ExecutionStrategy strategy = policy.GetStrategy().value_or(ChooseExecutionStrategy(execution_thresholds_, cost, max_term_cost));
+    if (ThreadPool::IsWorkerThread()) {
+        // Внутри задачи пула параллельная часть выполнилась бы в том же потоке, а последовательный MaxScore быстрее полного перебора
+        strategy = ExecutionStrategy::SEQUENTIAL;
+    }
+    execution_strategy_counter_->Record(strategy);
+
+    switch (strategy) {
+    case ExecutionStrategy::PARALLEL_BY_TERM:
+        return FindTopDocumentsByTerm(policy.GetPool(), query, document_predicate, top_count);
+    case ExecutionStrategy::PARALLEL_BY_DOC_RANGE:
+        return FindTopDocumentsParsed(ThreadPoolPolicy(policy.GetPool()), query, document_predicate, top_count);
+    default:
+        if (query_evaluation_ == QueryEvaluation::MAX_SCORE) {
+            return FindTopDocumentsMaxScore(query, document_predicate, top_count);
+        }
+        return SelectTopDocuments(FindAllDocuments(query, document_predicate), top_count);
+    }
+}
 
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsByTerm(ThreadPool& pool, const Query& query, DocumentPredicate document_predicate,
+                                                           size_t top_count) const {
+    ScoredTerms plus_terms;
+    for (const std::string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            plus_terms.push_back({&word_to_document_freqs_[*term_id], ComputeWordInverseDocumentFreq(*term_id)});
+        }
+    }
+    MinusPostings minus_postings;
+    for (const std::string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            minus_postings.push_back(&word_to_document_freqs_[*term_id]);
+        }
+    }
+
+    // Проверка предиката и вклад слов считаются параллельно, а суммируются в порядке слов, как при полном переборе
+    std::vector<std::vector<std::pair<int, double>>> term_relevances(plus_terms.size());
+    pool.ParallelFor(plus_terms.size(), [&](size_t index) {
+        const auto& [postings, inverse_document_freq] = plus_terms[index];
+        auto& relevances = term_relevances[index];
+        relevances.reserve(postings->size());
+        for (const auto [ordinal, term_freq] : *postings) {
+            if (document_predicate(documents_.GetDocumentId(ordinal), documents_.GetStatus(ordinal), documents_.GetRating(ordinal))) {
+                relevances.push_back({ordinal, term_freq * inverse_document_freq});
+            }
+        }
+    });
+    size_t expected_size = 0;
+    for (const auto& relevances : term_relevances) {
+        expected_size = std::max(expected_size, relevances.size());
     }
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(
-            {document_id, relevance, documents_.at(document_id).rating});
+    ScoreAccumulator document_to_relevance(expected_size);
+    for (const auto& relevances : term_relevances) {
+        for (const auto& [ordinal, relevance] : relevances) {
+            document_to_relevance[ordinal] += relevance;
+        }
     }
-    return matched_documents;
+    return SelectTopDocuments(document_to_relevance, minus_postings, top_count);
 }
 
-template <typename DocumentPredicate, typename QueryType>
-std::vector<Document> SearchServer::FindAllDocuments(const QueryType& query, DocumentPredicate document_predicate) const {
-    return FindAllDocuments(std::execution::seq, query, document_predicate);
+template <typename DocumentPredicate>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsShared(const std::vector<Query>& queries, DocumentPredicate document_predicate,
+                                                                        size_t top_count, std::optional<DocumentStatus> status) const {
+    // Слова обходятся в порядке множества, как и в отдельном запросе, поэтому релевантность каждого запроса
+    // складывается в том же порядке и совпадает до бита
+    std::map<std::string_view, std::vector<size_t>> word_to_queries;
+    std::vector<MinusPostings> minus_postings(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (const std::string_view& word : queries[i].plus_words) {
+            word_to_queries[word].push_back(i);
+        }
+        for (const std::string_view& word : queries[i].minus_words) {
+            if (const auto term_id = terms_.Find(word)) {
+                minus_postings[i].push_back(&word_to_document_freqs_[*term_id]);
+            }
+        }
+    }
+
+    std::vector<ScoreAccumulator> document_to_relevance(queries.size());
+    for (const auto& [word, query_indexes] : word_to_queries) {
+        const auto term_id = terms_.Find(word);
+        if (!term_id) {
+            continue;
+        }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(*term_id);
+        const PostingList& postings = status && status_postings_ ? status_postings_->Get(*term_id, *status) : word_to_document_freqs_[*term_id];
+        for (const auto [ordinal, term_freq] : postings) {
+            if (document_predicate(documents_.GetDocumentId(ordinal), documents_.GetStatus(ordinal), documents_.GetRating(ordinal))) {
+                const double relevance = term_freq * inverse_document_freq;
+                for (const size_t query_index : query_indexes) {
+                    document_to_relevance[query_index][ordinal] += relevance;
+                }
+            }
+        }
+    }
+
+    std::vector<std::vector<Document>> documents_lists(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        documents_lists[i] = SelectTopDocuments(document_to_relevance[i], minus_postings[i], top_count);
+        document_to_relevance[i] = ScoreAccumulator();
+    }
+    return documents_lists;
+}
+
+template <typename DocumentPredicate>
+SearchPage SearchServer::ScorePage(const ScoredTerms& plus_terms, const MinusPostings& minus_postings, DocumentPredicate document_predicate,
+                                   size_t page_size, const std::optional<SearchCursor>& cursor) const {
+    TopDocuments top_documents(page_size);
+    if (cursor) {
+        top_documents.SetAfter(cursor->last_document_);
+    }
+    ScoreMaxScore(plus_terms, minus_postings, document_predicate, top_documents);
+    SearchPage page;
+    page.documents = top_documents.Extract();
+    if (page_size > 0 && page.documents.size() == page_size) {
+        page.next_cursor = SearchCursor(page.documents.back());
+    }
+    return page;
+}
+
+template <typename DocumentPredicate>
+SearchResult SearchServer::ScoreWithinBudget(ScoredTerms plus_terms, const MinusPostings& minus_postings, const SearchBudget& budget,
+                                             DocumentPredicate document_predicate, size_t top_count) const {
+    // Убывание IDF — это возрастание документной частоты, даже когда читаются разделы по статусам.
+    // Релевантность суммируется в этом порядке, а не в порядке слов запроса, поэтому может отличаться от FindTopDocuments в последних битах
+    std::stable_sort(plus_terms.begin(), plus_terms.end(), [](const ScoredTerm& lhs, const ScoredTerm& rhs) {
+        return lhs.inverse_document_freq > rhs.inverse_document_freq;
+    });
+    BudgetMeter budget_meter(budget);
+    ScoreAccumulator document_to_relevance(plus_terms.empty() ? 0 : plus_terms[0].postings->size());
+    {
+        INSTRUMENT_SEARCH_STAGE(POSTING_TRAVERSAL);
+        INSTRUMENT_SAMPLED_STAGE(predicate_stage, PREDICATE);
+        for (const auto& [postings, inverse_document_freq] : plus_terms) {
+            auto it = postings->begin();
+            for (; it != postings->end() && budget_meter.Spend(); ++it) {
+                const auto [ordinal, term_freq] = *it;
+                if (INSTRUMENT_SAMPLED_CALL(predicate_stage, document_predicate(documents_.GetDocumentId(ordinal), documents_.GetStatus(ordinal),
+                                                                                 documents_.GetRating(ordinal)))) {
+                    document_to_relevance[ordinal] += term_freq * inverse_document_freq;
+                }
+            }
+            if (it != postings->end()) {
+                break;
+            }
+        }
+    }
+    INSTRUMENT_SEARCH_COUNT(POSTINGS_VISITED, budget_meter.GetSpentPostings());
+    INSTRUMENT_SEARCH_COUNT(DOCUMENTS_SCORED, document_to_relevance.size());
+    search_budget_counter_->Record(budget_meter.GetExhaustion());
+    return {SelectTopDocuments(document_to_relevance, minus_postings, top_count), budget_meter.GetExhaustion() != BudgetExhaustion::NONE};
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPartitioned(const ExecutionPolicy& policy, const QueryParPolicy& query, DocumentPredicate document_predicate,
+                                                                size_t top_count) const {
+    std::vector<std::pair<const PostingList*, double>> plus_postings;
+    for (const std::string_view& word : query.plus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            plus_postings.push_back({&word_to_document_freqs_[*term_id], ComputeWordInverseDocumentFreq(*term_id)});
+        }
+    }
+    std::vector<const PostingList*> minus_postings;
+    for (const std::string_view& word : query.minus_words) {
+        if (const auto term_id = terms_.Find(word)) {
+            minus_postings.push_back(&word_to_document_freqs_[*term_id]);
+        }
+    }
+    if (plus_postings.empty()) {
+        return {};
+    }
+
+    // Каждый поток обрабатывает свой диапазон порядковых номеров документов без общих данных, поэтому блокировки не нужны
+    const size_t ordinal_bound = documents_.GetOrdinalBound();
+    const size_t partition_count = std::max<size_t>(1, std::min(partition_count_, ordinal_bound));
+    std::vector<TopDocuments> partition_top_documents(partition_count, TopDocuments(top_count));
+    ParallelFor(policy, partition_count, [&](size_t partition) {
+        const int first_ordinal = static_cast<int>(ordinal_bound * partition / partition_count);
+        const int last_ordinal = static_cast<int>(ordinal_bound * (partition + 1) / partition_count);
+        ScoreAccumulator document_to_relevance;
+        for (const auto& [postings, inverse_document_freq] : plus_postings) {
+            auto it = postings->begin();
+            it.Seek(first_ordinal);
+            for (; it != postings->end() && (*it).first < last_ordinal; ++it) {
+                const auto [ordinal, term_freq] = *it;
+                if (document_predicate(documents_.GetDocumentId(ordinal), documents_.GetStatus(ordinal), documents_.GetRating(ordinal))) {
+                    document_to_relevance[ordinal] += term_freq * inverse_document_freq;
+                }
+            }
+        }
+        std::vector<int> excluded_documents;
+        for (const PostingList* postings : minus_postings) {
+            auto it = postings->begin();
+            it.Seek(first_ordinal);
+            for (; it != postings->end() && (*it).first < last_ordinal; ++it) {
+                excluded_documents.push_back((*it).first);
+            }
+        }
+        std::sort(excluded_documents.begin(), excluded_documents.end());
+        auto& top_documents = partition_top_documents[partition];
+        document_to_relevance.ForEach([&](int ordinal, double relevance) {
+            if (!std::binary_search(excluded_documents.begin(), excluded_documents.end(), ordinal)) {
+                top_documents.Add({documents_.GetDocumentId(ordinal), relevance, documents_.GetRating(ordinal)});
+            }
+        });
+    });
+
+    TopDocuments top_documents(top_count);
+    for (const auto& partition_top : partition_top_documents) {
+        top_documents.Merge(partition_top);
+    }
+    return top_documents.Extract();
 }
@@ -0,0 +1,331 @@
+#include "segmented_search_server.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "string_processing.h"
+
+using namespace std;
+
+SegmentedSearchServer::SegmentedSearchServer(const string& stop_words_text, size_t segment_size)
+    : stop_words_text_(stop_words_text)
+    , segment_size_(max<size_t>(1, segment_size))
+    , empty_index_(stop_words_text)
+    , segments_(new Segments())
+    , mutable_segment_(make_unique<SearchServer>(stop_words_text)) {
+    merger_ = thread([this] {
+        RunMerger();
+    });
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    {
+        lock_guard lock(merge_signal_mutex_);
+        stopping_ = true;
+    }
+    merge_condition_.notify_one();
+    merger_.join();
+    delete segments_.load();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, const string_view& document, DocumentStatus status, const vector<int>& ratings) {
+    lock_guard lock(write_mutex_);
+    if (document_segments_.count(document_id)) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    mutable_segment_->AddDocument(document_id, document, status, ratings);
+    document_segments_[document_id] = mutable_segment_id_;
+    if (static_cast<size_t>(mutable_segment_->GetDocumentCount()) >= segment_size_) {
+        SealMutableSegment();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    lock_guard lock(write_mutex_);
+    const auto it = document_segments_.find(document_id);
+    if (it == document_segments_.end()) {
+        return;
+    }
+    const uint64_t segment_id = it->second;
+    document_segments_.erase(it);
+    if (segment_id == mutable_segment_id_) {
+        mutable_segment_->RemoveDocument(document_id);
+        return;
+    }
+
+    auto segments = make_unique<Segments>(*segments_.load());
+    for (Segment& segment : *segments) {
+        if (segment.id != segment_id) {
+            continue;
+        }
+        auto deleted_documents = make_shared<set<int>>(*segment.deleted_documents);
+        deleted_documents->insert(document_id);
+        auto deleted_document_freqs = make_shared<map<string, int, less<>>>(*segment.deleted_document_freqs);
+        for (const auto& [word, _] : segment.index->GetWordFrequencies(document_id)) {
+            ++(*deleted_document_freqs)[string(word)];
+        }
+        segment.deleted_documents = move(deleted_documents);
+        segment.deleted_document_freqs = move(deleted_document_freqs);
+        break;
+    }
+    PublishSegments(move(segments));
+    RequestMerge();
+}
+
+void SegmentedSearchServer::Flush() {
+    lock_guard lock(write_mutex_);
+    SealMutableSegment();
+}
+
+void SegmentedSearchServer::MergeSegments() {
+    while (MergeOnce()) {
+    }
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(
+                raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    }, top_count);
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(const string_view& raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string_view>, DocumentStatus> SegmentedSearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
+    return GetSnapshot().MatchDocument(raw_query, document_id);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    return GetSnapshot().GetDocumentCount();
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+    return GetSnapshot().segments_->size();
+}
+
+SegmentedSearchServer::Snapshot SegmentedSearchServer::GetSnapshot() const {
+    auto guard = epochs_.Pin();
+    return Snapshot(move(guard), segments_.load(), &empty_index_);
+}
+
+SegmentedSearchServer::Snapshot::Snapshot(EpochDomain::Guard guard, const Segments* segments, const SearchServer* empty_index)
+    : guard_(move(guard))
+    , segments_(segments)
+    , empty_index_(empty_index) {
+}
+
+vector<Document> SegmentedSearchServer::Snapshot::FindTopDocuments(const string_view& raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(
+                raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    }, top_count);
+}
+
+vector<Document> SegmentedSearchServer::Snapshot::FindTopDocuments(const string_view& raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string_view>, DocumentStatus> SegmentedSearchServer::Snapshot::MatchDocument(const string_view& raw_query, int document_id) const {
+    for (const Segment& segment : *segments_) {
+        if (segment.deleted_documents->count(document_id)) {
+            continue;
+        }
+        try {
+            return segment.index->MatchDocument(raw_query, document_id);
+        } catch (const out_of_range&) {
+        }
+    }
+    return empty_index_->MatchDocument(raw_query, document_id);
+}
+
+int SegmentedSearchServer::Snapshot::GetDocumentCount() const {
+    int document_count = 0;
+    for (const Segment& segment : *segments_) {
+        document_count += segment.GetDocumentCount();
+    }
+    return document_count;
+}
+
+vector<int> SegmentedSearchServer::Snapshot::GetDocumentIds() const {
+    vector<int> document_ids;
+    for (const Segment& segment : *segments_) {
+        for (const int document_id : *segment.index) {
+            if (!segment.deleted_documents->count(document_id)) {
+                document_ids.push_back(document_id);
+            }
+        }
+    }
+    sort(document_ids.begin(), document_ids.end());
+    return document_ids;
+}
+
+map<string_view, double> SegmentedSearchServer::Snapshot::GetWordFrequencies(int document_id) const {
+    for (const Segment& segment : *segments_) {
+        if (!segment.deleted_documents->count(document_id)) {
+            auto word_freqs = segment.index->GetWordFrequencies(document_id);
+            if (!word_freqs.empty()) {
+                return word_freqs;
+            }
+        }
+    }
+    return {};
+}
+
+optional<Fingerprint> SegmentedSearchServer::Snapshot::GetFingerprint(int document_id) const {
+    for (const Segment& segment : *segments_) {
+        if (!segment.deleted_documents->count(document_id)) {
+            if (const auto fingerprint = segment.index->GetFingerprint(document_id)) {
+                return fingerprint;
+            }
+        }
+    }
+    return nullopt;
+}
+
+int SegmentedSearchServer::Segment::GetDocumentCount() const {
+    return index->GetDocumentCount() - static_cast<int>(deleted_documents->size());
+}
+
+void SegmentedSearchServer::PublishSegments(unique_ptr<const Segments> segments) {
+    // Старая версия освобождается, когда её перестанут читать все закреплённые читатели
+    epochs_.Retire(segments_.exchange(segments.release()));
+}
+
+void SegmentedSearchServer::RequestMerge() {
+    {
+        lock_guard lock(merge_signal_mutex_);
+        merge_requested_ = true;
+    }
+    merge_condition_.notify_one();
+}
+
+void SegmentedSearchServer::SealMutableSegment() {
+    if (mutable_segment_->GetDocumentCount() == 0) {
+        return;
+    }
+    auto segments = make_unique<Segments>(*segments_.load());
+    segments->push_back(MakeSegment(mutable_segment_id_, move(mutable_segment_), {}));
+    PublishSegments(move(segments));
+    mutable_segment_ = make_unique<SearchServer>(stop_words_text_);
+    mutable_segment_id_ = next_segment_id_++;
+    RequestMerge();
+}
+
+SegmentedSearchServer::Segment SegmentedSearchServer::MakeSegment(uint64_t id, shared_ptr<const SearchServer> index, set<int> deleted_documents) const {
+    auto deleted_document_freqs = make_shared<map<string, int, less<>>>();
+    for (const int document_id : deleted_documents) {
+        for (const auto& [word, _] : index->GetWordFrequencies(document_id)) {
+            ++(*deleted_document_freqs)[string(word)];
+        }
+    }
+    return {id, move(index), make_shared<const set<int>>(move(deleted_documents)), move(deleted_document_freqs)};
+}
+
+SegmentedSearchServer::Segments SegmentedSearchServer::SelectSegmentsToMerge(const Segments& segments) const {
+    if (segments.size() > max_segment_count_) {
+        Segments candidates = segments;
+        sort(candidates.begin(), candidates.end(), [](const Segment& lhs, const Segment& rhs) {
+            return lhs.GetDocumentCount() < rhs.GetDocumentCount();
+        });
+        candidates.resize(merge_factor_);
+        return candidates;
+    }
+    // Сегмент, в котором удалена половина документов, переписывается целиком
+    for (const Segment& segment : segments) {
+        if (segment.deleted_documents->size() * 2 >= static_cast<size_t>(segment.index->GetDocumentCount())) {
+            return {segment};
+        }
+    }
+    return {};
+}
+
+bool SegmentedSearchServer::MergeOnce() {
+    lock_guard merge_lock(merge_mutex_);
+
+    const Segments sources = SelectSegmentsToMerge(*GetSnapshot().segments_);
+    if (sources.empty()) {
+        return false;
+    }
+    // Слияние идёт без блокировки писателей: исходные сегменты неизменяемы
+    auto merged_index = make_shared<SearchServer>(stop_words_text_);
+    for (const Segment& source : sources) {
+        merged_index->AddDocumentsFrom(*source.index, *source.deleted_documents);
+    }
+
+    lock_guard lock(write_mutex_);
+    const uint64_t merged_id = next_segment_id_++;
+    auto segments = make_unique<Segments>();
+    set<int> deleted_documents;
+    for (const Segment& segment : *segments_.load()) {
+        const auto source = find_if(sources.begin(), sources.end(), [&segment](const Segment& source) {
+            return source.id == segment.id;
+        });
+        if (source == sources.end()) {
+            segments->push_back(segment);
+            continue;
+        }
+        // Надгробия, появившиеся во время слияния, переносятся в новый сегмент
+        for (const int document_id : *segment.deleted_documents) {
+            if (!source->deleted_documents->count(document_id)) {
+                deleted_documents.insert(document_id);
+            }
+        }
+    }
+    for (const int document_id : *merged_index) {
+        const auto it = document_segments_.find(document_id);
+        if (it != document_segments_.end() && any_of(sources.begin(), sources.end(), [&it](const Segment& source) {
+            return source.id == it->second;
+        })) {
+            it->second = merged_id;
+        }
+    }
+    if (static_cast<size_t>(merged_index->GetDocumentCount()) > deleted_documents.size()) {
+        segments->push_back(MakeSegment(merged_id, move(merged_index), move(deleted_documents)));
+    }
+    PublishSegments(move(segments));
+    return true;
+}
+
+void SegmentedSearchServer::RunMerger() {
+    unique_lock lock(merge_signal_mutex_);
+    while (true) {
+        merge_condition_.wait(lock, [this] {
+            return stopping_ || merge_requested_;
+        });
+        if (stopping_) {
+            break;
+        }
+        merge_requested_ = false;
+        lock.unlock();
+        while (!stopping_ && MergeOnce()) {
+        }
+        lock.lock();
+    }
+}
+
+CollectionStatistics SegmentedSearchServer::CollectStatistics(const Segments& segments, const string_view& raw_query) {
+    CollectionStatistics statistics;
+    for (const Segment& segment : segments) {
+        statistics.document_count += segment.GetDocumentCount();
+    }
+    for (string_view word : SplitIntoWordsView(raw_query)) {
+        if (!word.empty() && word[0] == '-') {
+            word.remove_prefix(1);
+        }
+        if (statistics.document_freqs.count(word)) {
+            continue;
+        }
+        int document_freq = 0;
+        for (const Segment& segment : segments) {
+            document_freq += segment.index->GetDocumentFrequency(word);
+            const auto it = segment.deleted_document_freqs->find(word);
+            if (it != segment.deleted_document_freqs->end()) {
+                document_freq -= it->second;
+            }
+        }
+        statistics.document_freqs[word] = document_freq;
+    }
+    return statistics;
+}
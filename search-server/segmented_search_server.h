@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "epoch_domain.h"
+#include "fingerprint.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+// Индекс из сегментов: новые документы копятся в изменяемом сегменте и становятся видны запросам
+// после его запечатывания, запечатанные сегменты не меняются, а удалённые из них документы хранятся как надгробия.
+// Запросы читают опубликованный набор сегментов и не ждут писателей, фоновый поток сливает мелкие сегменты.
+class SegmentedSearchServer {
+    struct Segment;
+    using Segments = std::vector<Segment>;
+public:
+    // Версия индекса на момент создания: все запросы к снимку видят одни и те же документы.
+    // Пока снимок жив, старые версии не освобождаются, поэтому держать его долго не стоит
+    class Snapshot {
+    public:
+        template <typename DocumentPredicate>
+        std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                               size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+        std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+                                               size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+        std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+        std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view& raw_query, int document_id) const;
+
+        int GetDocumentCount() const;
+        std::vector<int> GetDocumentIds() const;
+        std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+        std::optional<Fingerprint> GetFingerprint(int document_id) const;
+    private:
+        friend class SegmentedSearchServer;
+        Snapshot(EpochDomain::Guard guard, const Segments* segments, const SearchServer* empty_index);
+
+        EpochDomain::Guard guard_;
+        const Segments* segments_;
+        const SearchServer* empty_index_;
+    };
+
+    explicit SegmentedSearchServer(const std::string& stop_words_text, size_t segment_size = DEFAULT_SEGMENT_SIZE);
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    // Документ попадает в изменяемый сегмент и не виден запросам, MatchDocument и GetDocumentCount,
+    // пока сегмент не запечатан: это происходит после segment_size документов или при вызове Flush
+    void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+    // Удаление из запечатанного сегмента видно сразу, а незапечатанный документ просто не станет видимым
+    void RemoveDocument(int document_id);
+    // Запечатывает изменяемый сегмент, после чего его документы видны запросам
+    void Flush();
+    // Синхронно сливает сегменты, пока политика слияния находит работу
+    void MergeSegments();
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+    // Для документа, которого нет в запечатанных сегментах (в том числе ещё не запечатанного), бросает out_of_range
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view& raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    size_t GetSegmentCount() const;
+
+    Snapshot GetSnapshot() const;
+
+    static constexpr size_t DEFAULT_SEGMENT_SIZE = 4096;
+private:
+    struct Segment {
+        uint64_t id = 0;
+        std::shared_ptr<const SearchServer> index;
+        std::shared_ptr<const std::set<int>> deleted_documents;
+        std::shared_ptr<const std::map<std::string, int, std::less<>>> deleted_document_freqs;
+
+        int GetDocumentCount() const;
+    };
+
+    static constexpr size_t max_segment_count_ = 8;
+    static constexpr size_t merge_factor_ = 4;
+
+    const std::string stop_words_text_;
+    const size_t segment_size_;
+    const SearchServer empty_index_;
+    mutable EpochDomain epochs_;
+    std::atomic<const Segments*> segments_;
+
+    std::mutex write_mutex_;
+    std::unique_ptr<SearchServer> mutable_segment_;
+    uint64_t mutable_segment_id_ = 0;
+    uint64_t next_segment_id_ = 1;
+    std::unordered_map<int, uint64_t> document_segments_;
+
+    std::mutex merge_mutex_;
+    std::mutex merge_signal_mutex_;
+    std::condition_variable merge_condition_;
+    bool merge_requested_ = false;
+    std::atomic<bool> stopping_ = false;
+    std::thread merger_;
+
+    void PublishSegments(std::unique_ptr<const Segments> segments);
+    void RequestMerge();
+
+    void SealMutableSegment();
+    Segment MakeSegment(uint64_t id, std::shared_ptr<const SearchServer> index, std::set<int> deleted_documents) const;
+
+    Segments SelectSegmentsToMerge(const Segments& segments) const;
+    bool MergeOnce();
+    void RunMerger();
+
+    static CollectionStatistics CollectStatistics(const Segments& segments, const std::string_view& raw_query);
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                              size_t top_count) const {
+    return GetSnapshot().FindTopDocuments(raw_query, document_predicate, top_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::Snapshot::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                                        size_t top_count) const {
+    if (segments_->empty()) {
+        return empty_index_->FindTopDocuments(raw_query, document_predicate, top_count);
+    }
+    // IDF считается по живым документам всех сегментов, поэтому результат совпадает с единым индексом
+    const CollectionStatistics statistics = CollectStatistics(*segments_, raw_query);
+    TopDocuments top_documents(top_count);
+    for (const Segment& segment : *segments_) {
+        const auto& deleted_documents = *segment.deleted_documents;
+        const auto documents = segment.index->FindTopDocumentsWithStatistics(
+                    statistics, raw_query,
+                    [&](int document_id, DocumentStatus status, int rating) {
+            return deleted_documents.count(document_id) == 0 && document_predicate(document_id, status, rating);
+        }, top_count);
+        for (const Document& document : documents) {
+            top_documents.Add(document);
+        }
+    }
+    return top_documents.Extract();
+}
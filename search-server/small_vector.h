@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Вектор, который первые N элементов хранит внутри себя и обращается к куче только при переполнении
+template <typename T, size_t N>
+class SmallVector {
+public:
+    void push_back(T value) {
+        if (!overflow_.empty() || size_ == N) {
+            if (overflow_.empty()) {
+                overflow_.reserve(2 * N);
+                for (T& item : inline_) {
+                    overflow_.push_back(std::move(item));
+                }
+            }
+            overflow_.push_back(std::move(value));
+        } else {
+            inline_[size_] = std::move(value);
+        }
+        ++size_;
+    }
+
+    void clear() {
+        size_ = 0;
+        overflow_.clear();
+    }
+
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    T* data() {
+        return overflow_.empty() ? inline_.data() : overflow_.data();
+    }
+    const T* data() const {
+        return overflow_.empty() ? inline_.data() : overflow_.data();
+    }
+
+    T& operator[](size_t index) {
+        return data()[index];
+    }
+    const T& operator[](size_t index) const {
+        return data()[index];
+    }
+
+    T* begin() {
+        return data();
+    }
+    T* end() {
+        return data() + size_;
+    }
+    const T* begin() const {
+        return data();
+    }
+    const T* end() const {
+        return data() + size_;
+    }
+private:
+    std::array<T, N> inline_{};
+    std::vector<T> overflow_;
+    size_t size_ = 0;
+};
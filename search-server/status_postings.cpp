@@ -0,0 +1,90 @@
+#include "status_postings.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+StatusPostings::StatusPostings(bool impact_ordered)
+    : impact_ordered_(impact_ordered) {
+}
+
+bool StatusPostings::IsImpactOrdered() const {
+    return impact_ordered_;
+}
+
+void StatusPostings::Resize(size_t term_count) {
+    if (terms_.size() < term_count) {
+        terms_.resize(term_count);
+    }
+}
+
+void StatusPostings::Insert(int term_id, DocumentStatus status, int ordinal, double term_freq) {
+    auto& partitions = terms_[term_id];
+    partitions.by_ordinal[static_cast<size_t>(status)].Insert(ordinal, term_freq);
+    if (impact_ordered_) {
+        partitions.by_impact[static_cast<size_t>(status)].pending.push_back({ordinal, term_freq});
+    }
+}
+
+void StatusPostings::Erase(int term_id, DocumentStatus status, int ordinal, double term_freq) {
+    auto& partitions = terms_[term_id];
+    partitions.by_ordinal[static_cast<size_t>(status)].Erase(ordinal);
+    if (impact_ordered_) {
+        partitions.by_impact[static_cast<size_t>(status)].postings.Erase(ordinal, term_freq);
+    }
+}
+
+void StatusPostings::Erase(int term_id, DocumentStatus status, const vector<int>& ordinals) {
+    auto& partitions = terms_[term_id];
+    partitions.by_ordinal[static_cast<size_t>(status)].Erase(ordinals);
+    if (impact_ordered_) {
+        auto& partition = partitions.by_impact[static_cast<size_t>(status)];
+        partition.postings.Erase(ordinals);
+        partition.pending.erase(remove_if(partition.pending.begin(), partition.pending.end(),
+                                          [&ordinals](const ImpactPostingList::Posting& posting) {
+            return binary_search(ordinals.begin(), ordinals.end(), posting.first);
+        }), partition.pending.end());
+    }
+}
+
+void StatusPostings::Flush(int term_id) {
+    if (!impact_ordered_) {
+        return;
+    }
+    for (auto& partition : terms_[term_id].by_impact) {
+        if (!partition.pending.empty()) {
+            partition.postings.Insert(move(partition.pending));
+            partition.pending.clear();
+        }
+    }
+}
+
+void StatusPostings::Clear(int term_id) {
+    terms_[term_id] = TermPartitions();
+}
+
+void StatusPostings::RemapDocuments(const vector<int>& new_ordinals) {
+    // Сжатие сохраняет порядок документов, поэтому оба упорядочения разделов остаются верными
+    for (auto& partitions : terms_) {
+        for (auto& postings : partitions.by_ordinal) {
+            if (!postings.empty()) {
+                postings.RemapDocuments(new_ordinals);
+            }
+        }
+        for (auto& partition : partitions.by_impact) {
+            partition.postings.RemapDocuments(new_ordinals);
+            for (auto& [ordinal, _] : partition.pending) {
+                ordinal = new_ordinals[ordinal];
+            }
+        }
+    }
+}
+
+const PostingList& StatusPostings::Get(int term_id, DocumentStatus status) const {
+    return terms_[term_id].by_ordinal[static_cast<size_t>(status)];
+}
+
+const ImpactPostingList& StatusPostings::GetByImpact(int term_id, DocumentStatus status) const {
+    return terms_[term_id].by_impact[static_cast<size_t>(status)].postings;
+}
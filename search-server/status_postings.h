@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "document.h"
+#include "impact_posting_list.h"
+#include "posting_list.h"
+
+const size_t DOCUMENT_STATUS_COUNT = 4;
+
+// Как хранить списки документов слов помимо общего списка по порядковым номерам
+enum class PostingLayout {
+    ORDINAL,
+    // Дополнительно разложены по статусам: запрос с фильтром по статусу не читает документы других статусов
+    STATUS_PARTITIONED,
+    // Разделы по статусам ещё и в порядке убывания частоты слова: запрос из одного слова останавливается после top_count документов
+    IMPACT_ORDERED,
+};
+
+// Списки документов каждого слова, разложенные по статусам документов. Раздел меняется только вместе с общим списком,
+// поэтому записи одного слова можно менять в одной задаче независимо от других слов
+class StatusPostings {
+public:
+    explicit StatusPostings(bool impact_ordered);
+
+    bool IsImpactOrdered() const;
+
+    void Resize(size_t term_count);
+    // Записи в порядке по влиянию становятся видны поиску только после Flush для того же слова.
+    // Одиночные изменения раздела по влиянию буферизуются, поэтому стоят амортизированно столько же, сколько в PostingList
+    void Insert(int term_id, DocumentStatus status, int ordinal, double term_freq);
+    void Erase(int term_id, DocumentStatus status, int ordinal, double term_freq);
+    // Удаляет из раздела документы из отсортированного по возрастанию списка
+    void Erase(int term_id, DocumentStatus status, const std::vector<int>& ordinals);
+    void Flush(int term_id);
+    void Clear(int term_id);
+    void RemapDocuments(const std::vector<int>& new_ordinals);
+
+    const PostingList& Get(int term_id, DocumentStatus status) const;
+    // Документы раздела по убыванию частоты слова, при равной частоте по возрастанию порядковых номеров
+    const ImpactPostingList& GetByImpact(int term_id, DocumentStatus status) const;
+private:
+    struct ImpactPartition {
+        ImpactPostingList postings;
+        std::vector<ImpactPostingList::Posting> pending;
+    };
+    struct TermPartitions {
+        std::array<PostingList, DOCUMENT_STATUS_COUNT> by_ordinal;
+        std::array<ImpactPartition, DOCUMENT_STATUS_COUNT> by_impact;
+    };
+
+    bool impact_ordered_;
+    std::vector<TermPartitions> terms_;
+};
@@ -1,5 +1,14 @@
 #include "string_processing.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOKENIZER_X86 1
+#endif
+
 using namespace std;
 
 vector<string> SplitIntoWords(const string& text) {
@@ -21,14 +30,199 @@ vector<string> SplitIntoWords(const string& text) {
     return words;
 }
 
+namespace {
+
+// Текст размечается блоками по 64 байта: бит i маски соответствует i-му байту блока
+constexpr size_t BLOCK_SIZE = 64;
+constexpr size_t CHUNK_BLOCK_COUNT = 64;
+
+using MaskFunction = void (*)(const char* data, size_t block_count, uint64_t* space_masks, uint64_t* control_masks);
+
+bool IsControlCharacter(char c) {
+    return c >= '\0' && c < ' ';
+}
+
+// Неполный последний блок добивается пробелами, чтобы слово закончилось ровно на конце текста
+void ComputeMasksScalar(const char* data, size_t size, uint64_t& space_mask, uint64_t& control_mask) {
+    space_mask = size < BLOCK_SIZE ? ~uint64_t{0} << size : 0;
+    control_mask = 0;
+    for (size_t i = 0; i < size; ++i) {
+        space_mask |= uint64_t{data[i] == ' '} << i;
+        control_mask |= uint64_t{IsControlCharacter(data[i])} << i;
+    }
+}
+
+void ComputeBlockMasksScalar(const char* data, size_t block_count, uint64_t* space_masks, uint64_t* control_masks) {
+    for (size_t block = 0; block < block_count; ++block) {
+        ComputeMasksScalar(data + block * BLOCK_SIZE, BLOCK_SIZE, space_masks[block], control_masks[block]);
+    }
+}
+
+#ifdef TOKENIZER_X86
+void ComputeBlockMasksSse2(const char* data, size_t block_count, uint64_t* space_masks, uint64_t* control_masks) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    for (size_t block = 0; block < block_count; ++block) {
+        uint64_t space_mask = 0;
+        uint64_t control_mask = 0;
+        for (size_t part = 0; part < BLOCK_SIZE / 16; ++part) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + block * BLOCK_SIZE + part * 16));
+            const __m128i is_control = _mm_and_si128(_mm_cmpgt_epi8(bytes, minus_one), _mm_cmplt_epi8(bytes, space));
+            space_mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, space)))) << (part * 16);
+            control_mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(is_control))) << (part * 16);
+        }
+        space_masks[block] = space_mask;
+        control_masks[block] = control_mask;
+    }
+}
+
+__attribute__((target("avx2")))
+void ComputeBlockMasksAvx2(const char* data, size_t block_count, uint64_t* space_masks, uint64_t* control_masks) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i minus_one = _mm256_set1_epi8(-1);
+    for (size_t block = 0; block < block_count; ++block) {
+        uint64_t space_mask = 0;
+        uint64_t control_mask = 0;
+        for (size_t part = 0; part < BLOCK_SIZE / 32; ++part) {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + block * BLOCK_SIZE + part * 32));
+            const __m256i is_control = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, minus_one), _mm256_cmpgt_epi8(space, bytes));
+            space_mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, space)))) << (part * 32);
+            control_mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(is_control))) << (part * 32);
+        }
+        space_masks[block] = space_mask;
+        control_masks[block] = control_mask;
+    }
+}
+#endif
+
+bool IsSupported(TokenizerIsa isa) {
+    switch (isa) {
+    case TokenizerIsa::SCALAR:
+        return true;
+#ifdef TOKENIZER_X86
+    case TokenizerIsa::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case TokenizerIsa::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+MaskFunction GetMaskFunction(TokenizerIsa isa) {
+    switch (isa) {
+#ifdef TOKENIZER_X86
+    case TokenizerIsa::SSE2:
+        return ComputeBlockMasksSse2;
+    case TokenizerIsa::AVX2:
+        return ComputeBlockMasksAvx2;
+#endif
+    default:
+        return ComputeBlockMasksScalar;
+    }
+}
+
+TokenizerIsa DetectTokenizerIsa() {
+    for (const TokenizerIsa isa : {TokenizerIsa::AVX2, TokenizerIsa::SSE2}) {
+        if (IsSupported(isa)) {
+            return isa;
+        }
+    }
+    return TokenizerIsa::SCALAR;
+}
+
+atomic<TokenizerIsa>& CurrentIsa() {
+    static atomic<TokenizerIsa> isa = DetectTokenizerIsa();
+    return isa;
+}
+
+// Обходит маски блоков: каждый бит смены «пробел/не пробел» начинает или заканчивает слово.
+// Возвращает позицию первого управляющего символа или npos
+template <typename WordCallback>
+size_t ScanText(string_view str, WordCallback on_word) {
+    const MaskFunction compute_block_masks = GetMaskFunction(CurrentIsa().load(memory_order_relaxed));
+    uint64_t space_masks[CHUNK_BLOCK_COUNT];
+    uint64_t control_masks[CHUNK_BLOCK_COUNT];
+    size_t first_control = string_view::npos;
+    bool in_word = false;
+    size_t word_start = 0;
+    for (size_t chunk = 0; chunk < str.size(); chunk += BLOCK_SIZE * CHUNK_BLOCK_COUNT) {
+        const size_t chunk_size = min(BLOCK_SIZE * CHUNK_BLOCK_COUNT, str.size() - chunk);
+        const size_t full_block_count = chunk_size / BLOCK_SIZE;
+        compute_block_masks(str.data() + chunk, full_block_count, space_masks, control_masks);
+        size_t block_count = full_block_count;
+        if (chunk_size % BLOCK_SIZE != 0) {
+            ComputeMasksScalar(str.data() + chunk + full_block_count * BLOCK_SIZE, chunk_size % BLOCK_SIZE,
+                               space_masks[block_count], control_masks[block_count]);
+            ++block_count;
+        }
+        for (size_t block = 0; block < block_count; ++block) {
+            const size_t block_start = chunk + block * BLOCK_SIZE;
+            if (control_masks[block] != 0 && first_control == string_view::npos) {
+                first_control = block_start + __builtin_ctzll(control_masks[block]);
+            }
+            const uint64_t word_mask = ~space_masks[block];
+            uint64_t transitions = word_mask ^ ((word_mask << 1) | uint64_t{in_word});
+            while (transitions != 0) {
+                const size_t position = block_start + __builtin_ctzll(transitions);
+                if (in_word) {
+                    on_word(str.substr(word_start, position - word_start));
+                } else {
+                    word_start = position;
+                }
+                in_word = !in_word;
+                transitions &= transitions - 1;
+            }
+        }
+    }
+    if (in_word) {
+        on_word(str.substr(word_start));
+    }
+    return first_control;
+}
+
+}
+
 vector<string_view> SplitIntoWordsView(string_view str) {
     vector<string_view> result;
-    int64_t pos = str.find_first_not_of(" ");
-    const int64_t pos_end = str.npos;
-    while (pos != pos_end) {
-        int64_t space = str.find(' ', pos);
-        result.push_back(space == pos_end ? str.substr(pos) : str.substr(pos, space - pos));
-        pos = str.find_first_not_of(" ", space);
+    ScanText(str, [&result](string_view word) {
+        result.push_back(word);
+    });
+    return result;
+}
+
+vector<string_view> SplitIntoWordsView(string_view str, optional<string_view>& first_invalid_word) {
+    vector<string_view> result;
+    const size_t first_control = ScanText(str, [&result](string_view word) {
+        result.push_back(word);
+    });
+    first_invalid_word.reset();
+    if (first_control != string_view::npos) {
+        // Управляющий символ не пробел, поэтому он всегда лежит внутри какого-то слова
+        const auto word = partition_point(result.begin(), result.end(), [&str, first_control](string_view word) {
+            return static_cast<size_t>(word.data() + word.size() - str.data()) <= first_control;
+        });
+        first_invalid_word = *word;
     }
     return result;
 }
+
+bool HasControlCharacters(string_view str) {
+    if (str.size() < BLOCK_SIZE) {
+        return any_of(str.begin(), str.end(), IsControlCharacter);
+    }
+    return ScanText(str, [](string_view) {}) != string_view::npos;
+}
+
+TokenizerIsa GetTokenizerIsa() {
+    return CurrentIsa().load();
+}
+
+bool SetTokenizerIsa(TokenizerIsa isa) {
+    if (!IsSupported(isa)) {
+        return false;
+    }
+    CurrentIsa().store(isa);
+    return true;
+}
@@ -1,13 +1,29 @@
 #pragma once
 
-#include <vector>
+#include <optional>
 #include <set>
+#include <string_view>
+#include <vector>
 
 #include "read_input_functions.h"
 
 std::vector<std::string> SplitIntoWords(const std::string& text);
 
 std::vector<std::string_view> SplitIntoWordsView(std::string_view str);
+// Тот же разбор, но за один проход ещё и находит первое слово с управляющим символом
+std::vector<std::string_view> SplitIntoWordsView(std::string_view str, std::optional<std::string_view>& first_invalid_word);
+
+bool HasControlCharacters(std::string_view str);
+
+// Набор инструкций, которым размечаются пробелы и управляющие символы; выбирается по процессору при запуске
+enum class TokenizerIsa {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+TokenizerIsa GetTokenizerIsa();
+bool SetTokenizerIsa(TokenizerIsa isa);
 
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
@@ -0,0 +1,249 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+// FNV-1a не зависит от реализации стандартной библиотеки, поэтому таблица из снимка читается любой сборкой
+uint64_t HashTerm(string_view term) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : term) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+}
+
+TermDictionary::TermDictionary(const uint64_t* offsets, const char* chars, size_t id_bound, size_t term_count,
+                               const int* lookup_table, size_t lookup_table_size)
+    : mapped_offsets_(offsets)
+    , mapped_chars_(chars)
+    , mapped_id_bound_(id_bound)
+    , mapped_term_count_(term_count)
+    , mapped_lookup_table_(lookup_table)
+    , mapped_lookup_table_size_(lookup_table_size) {
+}
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+    : id_to_term_(other.id_to_term_)
+    , free_ids_(other.free_ids_)
+    , mapped_offsets_(other.mapped_offsets_)
+    , mapped_chars_(other.mapped_chars_)
+    , mapped_id_bound_(other.mapped_id_bound_)
+    , mapped_term_count_(other.mapped_term_count_)
+    , mapped_lookup_table_(other.mapped_lookup_table_)
+    , mapped_lookup_table_size_(other.mapped_lookup_table_size_) {
+    CompactChunks();
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        *this = TermDictionary(other);
+    }
+    return *this;
+}
+
+// Блоки переезжают вместе с указателями на них, а у исходного словаря не остаётся места для записи в чужой блок
+TermDictionary::TermDictionary(TermDictionary&& other) noexcept
+    : chunks_(move(other.chunks_))
+    , chunk_position_(exchange(other.chunk_position_, nullptr))
+    , chunk_free_size_(exchange(other.chunk_free_size_, 0))
+    , stored_size_(exchange(other.stored_size_, 0))
+    , erased_size_(exchange(other.erased_size_, 0))
+    , id_to_term_(move(other.id_to_term_))
+    , term_to_id_(move(other.term_to_id_))
+    , free_ids_(move(other.free_ids_))
+    , mapped_offsets_(exchange(other.mapped_offsets_, nullptr))
+    , mapped_chars_(exchange(other.mapped_chars_, nullptr))
+    , mapped_id_bound_(exchange(other.mapped_id_bound_, 0))
+    , mapped_term_count_(exchange(other.mapped_term_count_, 0))
+    , mapped_lookup_table_(exchange(other.mapped_lookup_table_, nullptr))
+    , mapped_lookup_table_size_(exchange(other.mapped_lookup_table_size_, 0)) {
+}
+
+TermDictionary& TermDictionary::operator=(TermDictionary&& other) noexcept {
+    if (this != &other) {
+        chunks_ = move(other.chunks_);
+        chunk_position_ = exchange(other.chunk_position_, nullptr);
+        chunk_free_size_ = exchange(other.chunk_free_size_, 0);
+        stored_size_ = exchange(other.stored_size_, 0);
+        erased_size_ = exchange(other.erased_size_, 0);
+        id_to_term_ = move(other.id_to_term_);
+        term_to_id_ = move(other.term_to_id_);
+        free_ids_ = move(other.free_ids_);
+        mapped_offsets_ = exchange(other.mapped_offsets_, nullptr);
+        mapped_chars_ = exchange(other.mapped_chars_, nullptr);
+        mapped_id_bound_ = exchange(other.mapped_id_bound_, 0);
+        mapped_term_count_ = exchange(other.mapped_term_count_, 0);
+        mapped_lookup_table_ = exchange(other.mapped_lookup_table_, nullptr);
+        mapped_lookup_table_size_ = exchange(other.mapped_lookup_table_size_, 0);
+    }
+    return *this;
+}
+
+int TermDictionary::Intern(string_view term) {
+    if (const auto term_id = Find(term)) {
+        return *term_id;
+    }
+    Detach();
+    int term_id;
+    if (!free_ids_.empty()) {
+        term_id = free_ids_.back();
+        free_ids_.pop_back();
+    } else {
+        term_id = static_cast<int>(id_to_term_.size());
+        id_to_term_.emplace_back();
+    }
+    id_to_term_[term_id] = Store(term);
+    term_to_id_.emplace(id_to_term_[term_id], term_id);
+    return term_id;
+}
+
+void TermDictionary::Erase(int term_id) {
+    Detach();
+    if (term_to_id_.erase(id_to_term_.at(term_id)) == 0) {
+        return;
+    }
+    erased_size_ += id_to_term_[term_id].size();
+    id_to_term_[term_id] = {};
+    free_ids_.push_back(term_id);
+    if (erased_size_ >= chunk_size_ && erased_size_ > stored_size_ / 2) {
+        CompactChunks();
+    }
+}
+
+optional<int> TermDictionary::Find(string_view term) const {
+    if (mapped_offsets_ != nullptr) {
+        const size_t mask = mapped_lookup_table_size_ - 1;
+        size_t slot = HashTerm(term) & mask;
+        // Число проб ограничено размером таблицы, чтобы повреждённая таблица без свободных ячеек не зациклила поиск
+        for (size_t probe = 0; probe < mapped_lookup_table_size_; ++probe, slot = (slot + 1) & mask) {
+            const int term_id = mapped_lookup_table_[slot];
+            if (term_id < 0 || static_cast<size_t>(term_id) >= mapped_id_bound_) {
+                return nullopt;
+            }
+            if (GetMappedTerm(term_id) == term) {
+                return term_id;
+            }
+        }
+        return nullopt;
+    }
+    const auto it = term_to_id_.find(term);
+    if (it == term_to_id_.end()) {
+        return nullopt;
+    }
+    return it->second;
+}
+
+string_view TermDictionary::GetTerm(int term_id) const {
+    if (mapped_offsets_ != nullptr) {
+        if (term_id < 0 || static_cast<size_t>(term_id) >= mapped_id_bound_) {
+            throw out_of_range("Invalid term_id"s);
+        }
+        return GetMappedTerm(term_id);
+    }
+    return id_to_term_.at(term_id);
+}
+
+size_t TermDictionary::size() const {
+    return mapped_offsets_ != nullptr ? mapped_term_count_ : term_to_id_.size();
+}
+
+size_t TermDictionary::GetIdBound() const {
+    return mapped_offsets_ != nullptr ? mapped_id_bound_ : id_to_term_.size();
+}
+
+vector<int> TermDictionary::BuildLookupTable() const {
+    size_t table_size = 1;
+    while (table_size <= 2 * size()) {
+        table_size *= 2;
+    }
+    vector<int> table(table_size, -1);
+    for (size_t term_id = 0; term_id < GetIdBound(); ++term_id) {
+        const string_view term = GetTerm(static_cast<int>(term_id));
+        if (term.empty()) {
+            continue;
+        }
+        size_t slot = HashTerm(term) & (table_size - 1);
+        while (table[slot] >= 0) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        table[slot] = static_cast<int>(term_id);
+    }
+    return table;
+}
+
+string_view TermDictionary::GetMappedTerm(int term_id) const {
+    return {mapped_chars_ + mapped_offsets_[term_id], mapped_offsets_[term_id + 1] - mapped_offsets_[term_id]};
+}
+
+string_view TermDictionary::Store(string_view term) {
+    if (term.size() > chunk_free_size_) {
+        // Длинный термин получает отдельный блок, чтобы не бросать остаток текущего
+        if (term.size() > chunk_size_ / 4) {
+            chunks_.push_back(make_unique<char[]>(term.size()));
+            memcpy(chunks_.back().get(), term.data(), term.size());
+            stored_size_ += term.size();
+            return {chunks_.back().get(), term.size()};
+        }
+        chunks_.push_back(make_unique<char[]>(chunk_size_));
+        chunk_position_ = chunks_.back().get();
+        chunk_free_size_ = chunk_size_;
+    }
+    memcpy(chunk_position_, term.data(), term.size());
+    const string_view stored(chunk_position_, term.size());
+    chunk_position_ += term.size();
+    chunk_free_size_ -= term.size();
+    stored_size_ += term.size();
+    return stored;
+}
+
+void TermDictionary::CompactChunks() {
+    // Живые термины переписываются в новые блоки, старые блоки освобождаются вместе с удалёнными строками
+    vector<unique_ptr<char[]>> old_chunks = move(chunks_);
+    chunks_.clear();
+    chunk_position_ = nullptr;
+    chunk_free_size_ = 0;
+    stored_size_ = 0;
+    erased_size_ = 0;
+    if (mapped_offsets_ != nullptr) {
+        return;
+    }
+    term_to_id_.clear();
+    term_to_id_.reserve(id_to_term_.size() - free_ids_.size());
+    for (size_t term_id = 0; term_id < id_to_term_.size(); ++term_id) {
+        if (!id_to_term_[term_id].empty()) {
+            id_to_term_[term_id] = Store(id_to_term_[term_id]);
+            term_to_id_.emplace(id_to_term_[term_id], static_cast<int>(term_id));
+        }
+    }
+}
+
+void TermDictionary::Detach() {
+    if (mapped_offsets_ == nullptr) {
+        return;
+    }
+    // Строки остаются во внешней памяти: копируются только идентификаторы и хэш-таблица
+    for (size_t term_id = 0; term_id < mapped_id_bound_; ++term_id) {
+        const string_view term = GetMappedTerm(static_cast<int>(term_id));
+        id_to_term_.push_back(term);
+        if (term.empty()) {
+            free_ids_.push_back(static_cast<int>(term_id));
+        } else {
+            term_to_id_.emplace(term, static_cast<int>(term_id));
+        }
+    }
+    mapped_offsets_ = nullptr;
+    mapped_chars_ = nullptr;
+    mapped_id_bound_ = 0;
+    mapped_term_count_ = 0;
+    mapped_lookup_table_ = nullptr;
+    mapped_lookup_table_size_ = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Строки терминов лежат подряд в блоках общей памяти, а не в отдельной строке на каждый термин
+class TermDictionary {
+public:
+    TermDictionary() = default;
+    // Словарь ищет термины по внешним строкам и таблице поиска (например, в отображённом в память файле). Первое изменение
+    // строит хэш-таблицу в памяти, а строки по-прежнему читаются из внешней памяти, поэтому она должна жить дольше словаря.
+    // Термин term_id занимает символы chars с offsets[term_id] по offsets[term_id + 1], пустой термин оставляет id свободным.
+    // Таблица поиска построена BuildLookupTable
+    TermDictionary(const uint64_t* offsets, const char* chars, size_t id_bound, size_t term_count,
+                   const int* lookup_table, size_t lookup_table_size);
+    // Копия складывает строки в собственные блоки, поэтому не зависит от исходного словаря
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary(TermDictionary&& other) noexcept;
+    TermDictionary& operator=(TermDictionary&& other) noexcept;
+
+    int Intern(std::string_view term);
+    void Erase(int term_id);
+
+    std::optional<int> Find(std::string_view term) const;
+    std::string_view GetTerm(int term_id) const;
+
+    size_t size() const;
+    size_t GetIdBound() const;
+
+    // Таблица с открытой адресацией для поиска без хэш-таблицы в памяти: размер — степень двойки, больше числа терминов,
+    // в ячейке идентификатор термина или -1
+    std::vector<int> BuildLookupTable() const;
+private:
+    static constexpr size_t chunk_size_ = 64 << 10;
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char* chunk_position_ = nullptr;
+    size_t chunk_free_size_ = 0;
+    // Строки удалённых терминов остаются в блоках, пока их не наберётся больше, чем живых
+    size_t stored_size_ = 0;
+    size_t erased_size_ = 0;
+
+    std::vector<std::string_view> id_to_term_;
+    std::unordered_map<std::string_view, int> term_to_id_;
+    std::vector<int> free_ids_;
+
+    const uint64_t* mapped_offsets_ = nullptr;
+    const char* mapped_chars_ = nullptr;
+    size_t mapped_id_bound_ = 0;
+    size_t mapped_term_count_ = 0;
+    const int* mapped_lookup_table_ = nullptr;
+    size_t mapped_lookup_table_size_ = 0;
+
+    std::string_view GetMappedTerm(int term_id) const;
+    std::string_view Store(std::string_view term);
+    void CompactChunks();
+    void Detach();
+};
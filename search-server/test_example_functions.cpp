@@ -1,5 +1,28 @@
 #include "test_example_functions.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+#include "epoch_domain.h"
+#include "impact_posting_list.h"
+#include "instrumentation.h"
+#include "segmented_search_server.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
+#include "top_documents.h"
+
 void PrintMatchDocumentResult(int document_id, const vector<string_view>& words, DocumentStatus status) {
     cout << "{ "s
         << "document_id = "s << document_id << ", "s
@@ -45,3 +68,724 @@ void MatchDocuments(const SearchServer& search_server, const string_view& query)
         cout << "Ошибка матчинга документов на запрос "s << query << ": "s << e.what() << endl;
     }
 }
+
+namespace {
+
+void Check(bool condition, const string& hint) {
+    if (!condition) {
+        throw logic_error("Проверка не прошла: "s + hint);
+    }
+}
+
+// Параллельный поиск может складывать релевантность в другом порядке, поэтому она сравнивается с точностью до RELEVANCE_EPSILON
+bool AreSameDocuments(const vector<Document>& lhs, const vector<Document>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs[i].id != rhs[i].id || lhs[i].rating != rhs[i].rating || abs(lhs[i].relevance - rhs[i].relevance) >= RELEVANCE_EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const vector<string> TEST_WORDS = {"cat"s, "dog"s, "bird"s, "fish"s, "tail"s, "eye"s, "fur"s, "red"s, "big"s, "nose"s};
+
+string MakeRandomText(mt19937& generator, int max_word_count) {
+    string text;
+    const int word_count = 1 + generator() % max_word_count;
+    for (int i = 0; i < word_count; ++i) {
+        text += TEST_WORDS[generator() % TEST_WORDS.size()];
+        text += ' ';
+    }
+    return text;
+}
+
+// Маленький словарь даёт много документов с совпадающей с точностью до RELEVANCE_EPSILON релевантностью
+void AddRandomDocuments(SearchServer& search_server, mt19937& generator, int document_count, int max_rating = 500) {
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        search_server.AddDocument(document_id, MakeRandomText(generator, 6), static_cast<DocumentStatus>(generator() % 4),
+                                  {static_cast<int>(generator() % (2 * max_rating + 1)) - max_rating});
+    }
+}
+
+string MakeRandomQuery(mt19937& generator) {
+    string query = MakeRandomText(generator, 3);
+    if (generator() % 3 == 0) {
+        query += '-' + TEST_WORDS[generator() % TEST_WORDS.size()];
+    }
+    return query;
+}
+
+}  // namespace
+
+// Одиночные изменения раздела по влиянию копятся в буферах, но обход всегда идёт в порядке убывания частоты
+void TestImpactOrderedUpdates() {
+    mt19937 generator(21);
+    const auto is_more_impactful = [](const ImpactPostingList::Posting& lhs, const ImpactPostingList::Posting& rhs) {
+        return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+    };
+    ImpactPostingList postings;
+    set<ImpactPostingList::Posting, decltype(is_more_impactful)> expected(is_more_impactful);
+    vector<double> term_freqs(500);
+    for (int i = 0; i < 5000; ++i) {
+        const int ordinal = generator() % term_freqs.size();
+        if (term_freqs[ordinal] == 0.0) {
+            term_freqs[ordinal] = (1 + generator() % 8) / 8.0;
+            postings.Insert(ordinal, term_freqs[ordinal]);
+            expected.insert({ordinal, term_freqs[ordinal]});
+        } else {
+            Check(postings.Erase(ordinal, term_freqs[ordinal]), "erase "s + to_string(ordinal));
+            expected.erase({ordinal, term_freqs[ordinal]});
+            term_freqs[ordinal] = 0.0;
+        }
+        Check(postings.size() == expected.size(), "size after step "s + to_string(i));
+        if (i % 100 == 0) {
+            Check(equal(postings.begin(), postings.end(), expected.begin(), expected.end()), "order after step "s + to_string(i));
+        }
+    }
+
+    SearchServer ordinal_server(""s);
+    SearchServer impact_server(""s);
+    impact_server.SetPostingLayout(PostingLayout::IMPACT_ORDERED);
+    for (int document_id = 0; document_id < 400; ++document_id) {
+        const string text = MakeRandomText(generator, 6);
+        const DocumentStatus status = static_cast<DocumentStatus>(generator() % 4);
+        ordinal_server.AddDocument(document_id, text, status, {document_id % 7});
+        impact_server.AddDocument(document_id, text, status, {document_id % 7});
+    }
+    for (int i = 0; i < 3000; ++i) {
+        const int document_id = generator() % 450;
+        const DocumentStatus status = static_cast<DocumentStatus>(generator() % 4);
+        if (find(ordinal_server.begin(), ordinal_server.end(), document_id) == ordinal_server.end()) {
+            const string text = MakeRandomText(generator, 6);
+            ordinal_server.AddDocument(document_id, text, status, {document_id % 7});
+            impact_server.AddDocument(document_id, text, status, {document_id % 7});
+        } else if (generator() % 4 == 0) {
+            ordinal_server.RemoveDocument(document_id);
+            impact_server.RemoveDocument(document_id);
+        } else {
+            ordinal_server.UpdateDocumentStatus(document_id, status);
+            impact_server.UpdateDocumentStatus(document_id, status);
+        }
+        if (i % 50 == 0) {
+            for (const string& word : TEST_WORDS) {
+                Check(AreSameDocuments(ordinal_server.FindTopDocuments(word, status), impact_server.FindTopDocuments(word, status)),
+                      "step "s + to_string(i) + ": "s + word);
+            }
+        }
+    }
+}
+
+// Подготовленный запрос другого сервера разбирается заново, даже если тот лежал по тому же адресу и имел то же поколение
+void TestPreparedQueryFromAnotherServer() {
+    optional<SearchServer> search_server;
+    search_server.emplace(""s);
+    for (int document_id = 0; document_id < 50; ++document_id) {
+        search_server->AddDocument(document_id, "w"s + to_string(document_id) + " cat"s, DocumentStatus::ACTUAL, {1});
+    }
+    const PreparedQuery query = search_server->PrepareQuery("cat w49"s);
+    const SearchServer* old_address = &*search_server;
+    const uint64_t old_generation = search_server->GetGeneration();
+
+    search_server.emplace(""s);
+    search_server->AddDocument(0, "dog"s, DocumentStatus::ACTUAL, {1});
+    while (search_server->GetGeneration() < old_generation) {
+        search_server->UpdateDocumentStatus(0, DocumentStatus::ACTUAL);
+    }
+    Check(&*search_server == old_address && search_server->GetGeneration() == old_generation, "same address and generation"s);
+    Check(search_server->FindTopDocuments(query).empty(), "foreign prepared query is re-parsed"s);
+    const auto [words, status] = search_server->MatchDocument(query, 0);
+    Check(words.empty(), "foreign prepared query is re-parsed for matching"s);
+
+    const SearchServer copy = *search_server;
+    const PreparedQuery dog_query = search_server->PrepareQuery("dog"s);
+    Check(AreSameDocuments(copy.FindTopDocuments(dog_query), search_server->FindTopDocuments(dog_query)), "query prepared on the original works on a copy"s);
+}
+
+// Удалённые термины освобождают место в блоках строк, а копия словаря не ссылается на строки исходного
+void TestTermDictionaryChunks() {
+    const int term_count = 20000;
+    auto make_term = [](int index) {
+        return "term"s + to_string(index) + string(index % 7, 'x');
+    };
+    auto dictionary = make_unique<TermDictionary>();
+    for (int index = 0; index < term_count; ++index) {
+        Check(dictionary->Intern(make_term(index)) == index, "dense term ids"s);
+    }
+    for (int index = 0; index < term_count; ++index) {
+        if (index % 10 != 0) {
+            dictionary->Erase(index);
+        }
+    }
+    Check(dictionary->size() == term_count / 10, "erased terms are not counted"s);
+    Check(dictionary->Intern(make_term(1)) < term_count, "erased ids are reused"s);
+
+    const TermDictionary copy = *dictionary;
+    dictionary.reset();
+    for (int index = 0; index < term_count; ++index) {
+        const auto term_id = copy.Find(make_term(index));
+        Check(term_id.has_value() == (index % 10 == 0 || index == 1), "copy finds live terms only"s);
+        if (term_id) {
+            Check(copy.GetTerm(*term_id) == make_term(index), "copy keeps term text"s);
+        }
+    }
+}
+
+// Общие корзины гистограмм задержек: значение лежит между нижними границами своей и следующей корзины
+void TestLogLinearBuckets() {
+    for (const size_t sub_bucket_bits : {size_t(2), size_t(4)}) {
+        const size_t bucket_count = GetLogLinearBucketCount(sub_bucket_bits);
+        vector<uint64_t> values;
+        for (uint64_t value = 0; value < 5000; ++value) {
+            values.push_back(value);
+        }
+        for (size_t shift = 13; shift < 64; ++shift) {
+            values.push_back((uint64_t(1) << shift) - 1);
+            values.push_back(uint64_t(1) << shift);
+            values.push_back((uint64_t(1) << shift) + (uint64_t(1) << (shift - 3)));
+        }
+        values.push_back(numeric_limits<uint64_t>::max());
+        size_t previous_bucket = 0;
+        for (const uint64_t value : values) {
+            const size_t bucket = GetLogLinearBucket(value, sub_bucket_bits);
+            const string hint = to_string(sub_bucket_bits) + " bits, value "s + to_string(value);
+            Check(bucket < bucket_count && bucket >= previous_bucket, "bucket of "s + hint);
+            Check(GetLogLinearBucketLowerBound(bucket, sub_bucket_bits) <= value, "lower bound of "s + hint);
+            Check(bucket + 1 == bucket_count || value < GetLogLinearBucketLowerBound(bucket + 1, sub_bucket_bits), "upper bound of "s + hint);
+            previous_bucket = bucket;
+        }
+        Check(GetLogLinearBucket(numeric_limits<uint64_t>::max(), sub_bucket_bits) == bucket_count - 1, "last bucket, "s + to_string(sub_bucket_bits));
+    }
+}
+
+void TestTopDocumentsOrder() {
+    // Релевантности 0.5 и 0.5 + 1e-9 округляются до одного ключа, поэтому решает рейтинг
+    const vector<Document> documents = {
+        {765, 0.5, 355}, {669, 0.5 + 1e-9, -317}, {723, 0.5 - 1e-9, 61}, {1, 0.5, 61}, {2, 0.7, -1000}, {3, 0.3, 1000},
+    };
+    // Соседние релевантности цепочки отличаются меньше чем на RELEVANCE_EPSILON, а крайние — больше
+    vector<Document> all_documents = documents;
+    for (int i = 0; i < 3; ++i) {
+        all_documents.push_back({10 + i, 0.5 + i * 0.7e-6, 1 - i});
+        all_documents.push_back({20 + i, 0.25 + 0.3e-6 + i * 0.7e-6, 1 - i});
+    }
+    for (const Document& lhs : all_documents) {
+        Check(!TopDocuments::IsMoreRelevant(lhs, lhs), "документ не релевантнее самого себя"s);
+        for (const Document& rhs : all_documents) {
+            const string pair_hint = "документы "s + to_string(lhs.id) + " и "s + to_string(rhs.id);
+            Check(!(TopDocuments::IsMoreRelevant(lhs, rhs) && TopDocuments::IsMoreRelevant(rhs, lhs)),
+                  pair_hint + " не могут быть релевантнее друг друга"s);
+            Check(lhs.id == rhs.id || TopDocuments::IsMoreRelevant(lhs, rhs) || TopDocuments::IsMoreRelevant(rhs, lhs),
+                  pair_hint + " упорядочены"s);
+            for (const Document& third : all_documents) {
+                Check(!TopDocuments::IsMoreRelevant(lhs, rhs) || !TopDocuments::IsMoreRelevant(rhs, third)
+                          || TopDocuments::IsMoreRelevant(lhs, third),
+                      pair_hint + " и "s + to_string(third.id) + ": порядок транзитивен"s);
+            }
+        }
+    }
+    TopDocuments top_documents(4);
+    for (const Document& document : documents) {
+        top_documents.Add(document);
+    }
+    const vector<Document> top = top_documents.Extract();
+    const vector<int> expected_ids = {2, 765, 1, 723};
+    Check(top.size() == expected_ids.size(), "размер топа"s);
+    for (size_t i = 0; i < top.size(); ++i) {
+        Check(top[i].id == expected_ids[i], "позиция "s + to_string(i) + " топа"s);
+    }
+}
+
+void TestParallelSearchMatchesSequential() {
+    ThreadPool pool(4);
+    const auto is_even = [](int document_id, DocumentStatus status, int rating) {
+        return document_id % 2 == 0;
+    };
+    for (unsigned seed = 0; seed < 16; ++seed) {
+        mt19937 generator(seed);
+        SearchServer search_server("and with"s);
+        AddRandomDocuments(search_server, generator, 1500);
+        for (int query_index = 0; query_index < 20; ++query_index) {
+            const string query = MakeRandomQuery(generator);
+            const string hint = "seed "s + to_string(seed) + ", запрос \""s + query + "\""s;
+            for (const size_t top_count : {size_t(5), size_t(40)}) {
+                search_server.SetQueryEvaluation(QueryEvaluation::EXHAUSTIVE);
+                vector<Document> all = search_server.FindTopDocuments(execution::seq, query, is_even, search_server.GetDocumentCount());
+                Check(is_sorted(all.begin(), all.end(), TopDocuments::IsMoreRelevant), "порядок выдачи, "s + hint);
+                all.resize(min(all.size(), top_count));
+                const auto expected = search_server.FindTopDocuments(execution::seq, query, is_even, top_count);
+                Check(AreSameDocuments(expected, all), "полный перебор, "s + hint);
+
+                search_server.SetQueryEvaluation(QueryEvaluation::MAX_SCORE);
+                Check(AreSameDocuments(search_server.FindTopDocuments(execution::seq, query, is_even, top_count), expected),
+                      "MaxScore, "s + hint);
+                Check(AreSameDocuments(search_server.FindTopDocuments(execution::par, query, is_even, top_count), expected),
+                      "execution::par, "s + hint);
+                Check(AreSameDocuments(search_server.FindTopDocuments(ThreadPoolPolicy(pool), query, is_even, top_count), expected),
+                      "ThreadPoolPolicy, "s + hint);
+                for (const ExecutionStrategy strategy : {ExecutionStrategy::SEQUENTIAL, ExecutionStrategy::PARALLEL_BY_TERM,
+                                                         ExecutionStrategy::PARALLEL_BY_DOC_RANGE}) {
+                    Check(AreSameDocuments(search_server.FindTopDocuments(AdaptivePolicy(pool, strategy), query, is_even, top_count), expected),
+                          "AdaptivePolicy "s + to_string(static_cast<int>(strategy)) + ", "s + hint);
+                }
+            }
+            Check(AreSameDocuments(search_server.FindTopDocuments(execution::par, query, DocumentStatus::BANNED),
+                                   search_server.FindTopDocuments(execution::seq, query, DocumentStatus::BANNED)),
+                  "поиск по статусу, "s + hint);
+            Check(AreSameDocuments(search_server.FindTopDocuments(execution::par, query), search_server.FindTopDocuments(query)),
+                  "поиск по умолчанию, "s + hint);
+        }
+    }
+}
+
+// Страницы по курсору на цепочке документов, релевантности которых отличаются на 0.7 * RELEVANCE_EPSILON, а рейтинги убывают:
+// при сравнении с допуском такие документы на границе страниц пропадали или повторялись
+void TestPagesAcrossRelevanceChain() {
+    vector<Document> documents;
+    for (int i = 0; i < 9; ++i) {
+        documents.push_back({i, 0.5 + i * 0.7e-6, 10 - i});
+        documents.push_back({100 + i, 0.5 + i * 0.7e-6, 10 - i});
+    }
+    vector<Document> expected = documents;
+    sort(expected.begin(), expected.end(), TopDocuments::IsMoreRelevant);
+    for (const size_t page_size : {size_t(1), size_t(2), size_t(3), size_t(5)}) {
+        mt19937 generator(static_cast<unsigned>(page_size));
+        vector<Document> joined;
+        optional<Document> after;
+        while (true) {
+            // Порядок обхода в поиске не определён, поэтому документы подаются перемешанными
+            shuffle(documents.begin(), documents.end(), generator);
+            TopDocuments top_documents(page_size);
+            if (after) {
+                top_documents.SetAfter(*after);
+            }
+            for (const Document& document : documents) {
+                top_documents.Add(document);
+            }
+            const vector<Document> page = top_documents.Extract();
+            joined.insert(joined.end(), page.begin(), page.end());
+            if (page.size() < page_size) {
+                break;
+            }
+            after = page.back();
+        }
+        Check(joined.size() == expected.size(), "размер объединения страниц по "s + to_string(page_size));
+        for (size_t i = 0; i < joined.size(); ++i) {
+            Check(joined[i].id == expected[i].id, "позиция "s + to_string(i) + " на страницах по "s + to_string(page_size));
+        }
+    }
+}
+
+// Кэширующие перегрузки разбирают запрос один раз, и при промахе, и при попадании выдача совпадает с сервером без кэша
+void TestCachedSearchMatchesUncached() {
+    ThreadPool pool(4);
+    const auto is_even = [](int document_id, DocumentStatus status, int rating) {
+        return document_id % 2 == 0;
+    };
+    mt19937 generator(5);
+    SearchServer cached_server("and with"s);
+    SearchServer search_server("and with"s);
+    AddRandomDocuments(cached_server, generator, 1000);
+    generator.seed(5);
+    AddRandomDocuments(search_server, generator, 1000);
+    cached_server.EnableQueryCache(256);
+
+    auto check_policy = [&](const auto& policy, const string& query, const string& hint) {
+        const auto expected_status = search_server.FindTopDocuments(policy, query, DocumentStatus::BANNED);
+        const auto expected_tag = search_server.FindTopDocuments(policy, query, QueryCacheTag{"even"sv}, is_even);
+        for (int pass = 0; pass < 2; ++pass) {
+            Check(AreSameDocuments(cached_server.FindTopDocuments(policy, query, DocumentStatus::BANNED), expected_status), "status, "s + hint);
+            Check(AreSameDocuments(cached_server.FindTopDocuments(policy, query, QueryCacheTag{"even"sv}, is_even), expected_tag), "tag, "s + hint);
+        }
+    };
+    for (const PostingLayout layout : {PostingLayout::ORDINAL, PostingLayout::STATUS_PARTITIONED}) {
+        cached_server.SetPostingLayout(layout);
+        search_server.SetPostingLayout(layout);
+        for (int query_index = 0; query_index < 20; ++query_index) {
+            const string query = MakeRandomQuery(generator);
+            const string hint = "запрос \""s + query + "\""s;
+            check_policy(execution::seq, query, "execution::seq, "s + hint);
+            check_policy(execution::par, query, "execution::par, "s + hint);
+            check_policy(ThreadPoolPolicy(pool), query, "ThreadPoolPolicy, "s + hint);
+            for (const ExecutionStrategy strategy : {ExecutionStrategy::SEQUENTIAL, ExecutionStrategy::PARALLEL_BY_TERM,
+                                                     ExecutionStrategy::PARALLEL_BY_DOC_RANGE}) {
+                check_policy(AdaptivePolicy(pool, strategy), query, "AdaptivePolicy "s + to_string(static_cast<int>(strategy)) + ", "s + hint);
+            }
+        }
+    }
+    Check(cached_server.GetQueryCacheStats().hits > 0, "повторные запросы берутся из кэша"s);
+}
+
+void TestSearchPagesMatchFullRanking() {
+    const auto is_odd = [](int document_id, DocumentStatus status, int rating) {
+        return document_id % 2 == 1;
+    };
+    for (unsigned seed = 0; seed < 8; ++seed) {
+        mt19937 generator(seed);
+        SearchServer search_server("and with"s);
+        // Рейтинги из трёх значений дают документы, которые различаются только идентификатором, в том числе на границах страниц
+        AddRandomDocuments(search_server, generator, 1000, 1);
+        for (const PostingLayout layout : {PostingLayout::ORDINAL, PostingLayout::STATUS_PARTITIONED}) {
+            search_server.SetPostingLayout(layout);
+            for (int query_index = 0; query_index < 10; ++query_index) {
+                const string query = MakeRandomQuery(generator);
+                const size_t page_size = 1 + generator() % 50;
+                const string hint = "seed "s + to_string(seed) + ", запрос \""s + query + "\", страница "s + to_string(page_size);
+                const size_t all_count = search_server.GetDocumentCount();
+                const auto collect_pages = [&](const auto& find_page) {
+                    vector<Document> documents;
+                    optional<SearchCursor> cursor;
+                    do {
+                        SearchPage page = find_page(cursor);
+                        Check(page.documents.size() <= page_size, "размер страницы, "s + hint);
+                        documents.insert(documents.end(), page.documents.begin(), page.documents.end());
+                        // Курсор проходит через строку, как у клиента
+                        cursor.reset();
+                        if (page.next_cursor) {
+                            cursor = SearchCursor::FromString(page.next_cursor->ToString());
+                            Check(cursor.has_value(), "разбор курсора, "s + hint);
+                        }
+                    } while (cursor);
+                    return documents;
+                };
+                Check(AreSameDocuments(collect_pages([&](const optional<SearchCursor>& cursor) {
+                    return search_server.FindTopDocumentsPage(query, is_odd, page_size, cursor);
+                }), search_server.FindTopDocuments(query, is_odd, all_count)), "страницы с предикатом, "s + hint);
+                Check(AreSameDocuments(collect_pages([&](const optional<SearchCursor>& cursor) {
+                    return search_server.FindTopDocumentsPage(query, DocumentStatus::IRRELEVANT, page_size, cursor);
+                }), search_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, all_count)), "страницы по статусу, "s + hint);
+                Check(AreSameDocuments(collect_pages([&](const optional<SearchCursor>& cursor) {
+                    return search_server.FindTopDocumentsPage(query, page_size, cursor);
+                }), search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, all_count)), "страницы по умолчанию, "s + hint);
+            }
+        }
+    }
+    Check(!SearchCursor::FromString(""s), "пустой курсор"s);
+    Check(!SearchCursor::FromString("0x1p-1 5"s), "курсор без идентификатора"s);
+    Check(!SearchCursor::FromString("relevance 5 7"s), "курсор с неверной релевантностью"s);
+}
+
+void TestEpochDomainGrowsSlots() {
+    EpochDomain epochs;
+    bool is_deleted = false;
+    {
+        // Снимков больше, чем слотов в одном блоке: раньше Pin в этом случае ждал освобождения слота бесконечно
+        vector<EpochDomain::Guard> guards;
+        for (int i = 0; i < 1000; ++i) {
+            guards.push_back(epochs.Pin());
+        }
+        Check(epochs.GetSlotCount() >= guards.size(), "число слотов"s);
+        epochs.Retire(function<void()>([&is_deleted] {
+            is_deleted = true;
+        }));
+        Check(!is_deleted, "версия освобождена при закреплённых читателях"s);
+    }
+    epochs.Collect();
+    Check(is_deleted, "версия не освобождена после ухода читателей"s);
+}
+
+// Копия сервера не зависит от исходного: её можно менять и искать по ней после уничтожения оригинала
+void TestSearchServerCopy() {
+    auto make_server = [] {
+        mt19937 generator(3);
+        SearchServer search_server("and in on"s);
+        AddRandomDocuments(search_server, generator, 300);
+        search_server.SetPostingLayout(PostingLayout::STATUS_PARTITIONED);
+        search_server.EnableQueryCache(64);
+        return search_server;
+    };
+    auto modify = [](SearchServer& search_server) {
+        search_server.AddDocument(1000, "cat dog and fish"s, DocumentStatus::BANNED, {5});
+        search_server.RemoveDocument(7);
+        search_server.UpdateDocumentStatus(8, DocumentStatus::BANNED);
+    };
+    mt19937 generator(4);
+    auto check_same = [&generator](const SearchServer& expected, const SearchServer& actual, const string& hint) {
+        Check(vector<int>(expected.begin(), expected.end()) == vector<int>(actual.begin(), actual.end()), hint + ": document ids"s);
+        for (int i = 0; i < 20; ++i) {
+            const string query = MakeRandomQuery(generator);
+            Check(AreSameDocuments(expected.FindTopDocuments(query), actual.FindTopDocuments(query)), hint + ": "s + query);
+            Check(AreSameDocuments(expected.FindTopDocuments(query, DocumentStatus::BANNED), actual.FindTopDocuments(query, DocumentStatus::BANNED)),
+                  hint + ": banned "s + query);
+        }
+    };
+
+    auto original = make_unique<SearchServer>(make_server());
+    original->FindTopDocuments("cat dog"s);
+    SearchServer copy = *original;
+    Check(copy.GetQueryCacheStats().hits == 0 && copy.GetQueryCacheStats().size == 0, "copy starts with an empty cache"s);
+    modify(*original);
+    SearchServer expected_original = make_server();
+    modify(expected_original);
+    check_same(expected_original, *original, "modified original"s);
+    original.reset();
+    check_same(make_server(), copy, "copy after original is destroyed"s);
+
+    SearchServer assigned(""s);
+    assigned = copy;
+    modify(assigned);
+    check_same(expected_original, assigned, "modified assigned copy"s);
+    check_same(make_server(), copy, "copy after assigned copy is modified"s);
+}
+
+// Пакетное удаление на разных политиках сравнивается с удалением по одному документу. SearchServer не поддерживает
+// чтение во время изменения, поэтому читатели запускаются между раундами, после того как удаление завершилось
+void TestBatchRemovalMatchesSingleRemoval() {
+    const int document_count = 3000;
+    mt19937 generator(11);
+    SearchServer single_server(""s);
+    SearchServer batch_server(""s);
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        const string text = MakeRandomText(generator, 6) + "word"s + to_string(document_id % 97);
+        const DocumentStatus status = static_cast<DocumentStatus>(generator() % 2);
+        const int rating = static_cast<int>(generator() % 11) - 5;
+        single_server.AddDocument(document_id, text, status, {rating});
+        batch_server.AddDocument(document_id, text, status, {rating});
+    }
+    vector<string> queries;
+    for (int i = 0; i < 8; ++i) {
+        queries.push_back(MakeRandomQuery(generator) + " word"s + to_string(i));
+    }
+
+    vector<int> alive_ids(document_count);
+    iota(alive_ids.begin(), alive_ids.end(), 0);
+    shuffle(alive_ids.begin(), alive_ids.end(), generator);
+    ThreadPool pool(4);
+    for (int round = 0; !alive_ids.empty(); ++round) {
+        const size_t removed_count = min(alive_ids.size(), static_cast<size_t>(document_count / 8));
+        vector<int> removed_ids(alive_ids.end() - removed_count, alive_ids.end());
+        alive_ids.resize(alive_ids.size() - removed_count);
+        for (const int document_id : removed_ids) {
+            single_server.RemoveDocument(document_id);
+        }
+        // Повторы и неизвестные идентификаторы пропускаются
+        removed_ids.push_back(removed_ids.front());
+        removed_ids.push_back(document_count + round);
+        switch (round % 3) {
+        case 0:
+            batch_server.RemoveDocuments(execution::seq, removed_ids);
+            break;
+        case 1:
+            batch_server.RemoveDocuments(execution::par, removed_ids);
+            break;
+        default:
+            batch_server.RemoveDocuments(ThreadPoolPolicy(pool), removed_ids);
+        }
+
+        const string hint = "round "s + to_string(round);
+        Check(batch_server.GetDocumentCount() == single_server.GetDocumentCount(), hint + ": document count"s);
+        Check(batch_server.GetTermCount() == single_server.GetTermCount(), hint + ": term count"s);
+        Check(vector<int>(batch_server.begin(), batch_server.end()) == vector<int>(single_server.begin(), single_server.end()),
+              hint + ": document ids"s);
+        vector<future<void>> readers;
+        for (int reader = 0; reader < 3; ++reader) {
+            readers.push_back(async(launch::async, [&, reader] {
+                for (size_t i = reader; i < queries.size(); i += 3) {
+                    Check(AreSameDocuments(batch_server.FindTopDocuments(queries[i]), single_server.FindTopDocuments(queries[i])),
+                          hint + ": "s + queries[i]);
+                }
+            }));
+        }
+        for (auto& reader : readers) {
+            reader.get();
+        }
+    }
+    Check(batch_server.GetTermCount() == 0, "empty terms are pruned"s);
+}
+
+// Документы изменяемого сегмента не видны, пока он не запечатан
+void TestSegmentedWritesVisibleAfterSeal() {
+    SegmentedSearchServer search_server(""s, 3);
+    search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat bird"s, DocumentStatus::ACTUAL, {2});
+    Check(search_server.FindTopDocuments("cat"s).empty(), "unsealed documents are not found"s);
+    Check(search_server.GetDocumentCount() == 0, "unsealed documents are not counted"s);
+    bool thrown = false;
+    try {
+        search_server.MatchDocument("cat"s, 1);
+    } catch (const out_of_range&) {
+        thrown = true;
+    }
+    Check(thrown, "unsealed document is not matched"s);
+
+    // Заполненный сегмент запечатывается сам
+    search_server.AddDocument(3, "cat fish"s, DocumentStatus::ACTUAL, {3});
+    Check(search_server.FindTopDocuments("cat"s).size() == 3, "full segment is sealed"s);
+
+    search_server.AddDocument(4, "cat fur"s, DocumentStatus::ACTUAL, {4});
+    search_server.AddDocument(5, "cat eye"s, DocumentStatus::ACTUAL, {5});
+    search_server.RemoveDocument(5);
+    const auto snapshot = search_server.GetSnapshot();
+    search_server.Flush();
+    Check(snapshot.GetDocumentCount() == 3, "snapshot taken before Flush does not change"s);
+    Check(search_server.GetDocumentCount() == 4, "Flush seals the mutable segment"s);
+    const auto [words, status] = search_server.MatchDocument("cat fur"s, 4);
+    Check(words.size() == 2 && status == DocumentStatus::ACTUAL, "flushed document is matched"s);
+}
+
+// Писатель добавляет и удаляет документы, фоновый поток сливает сегменты, а читатели сверяют каждый снимок
+// с последовательным SearchServer из тех же документов. Снимок согласован, если выдача и IDF совпадают с моделью
+void TestSegmentedSnapshotsMatchModel() {
+    const int document_count = 600;
+    mt19937 generator(42);
+    vector<string> texts;
+    vector<DocumentStatus> statuses;
+    vector<int> ratings;
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        texts.push_back(MakeRandomText(generator, 6));
+        statuses.push_back(static_cast<DocumentStatus>(generator() % 2));
+        ratings.push_back(static_cast<int>(generator() % 11) - 5);
+    }
+    vector<string> queries;
+    for (int i = 0; i < 8; ++i) {
+        queries.push_back(MakeRandomQuery(generator));
+    }
+
+    SegmentedSearchServer search_server("and with"s, 8);
+    atomic<bool> is_writing = true;
+    auto writer = async(launch::async, [&] {
+        mt19937 writer_generator(7);
+        for (int document_id = 0; document_id < document_count; ++document_id) {
+            search_server.AddDocument(document_id, texts[document_id], statuses[document_id], {ratings[document_id]});
+            if (document_id % 3 == 0) {
+                search_server.RemoveDocument(writer_generator() % (document_id + 1));
+            }
+            if (document_id % 20 == 0) {
+                search_server.Flush();
+            }
+        }
+        search_server.Flush();
+        is_writing = false;
+    });
+
+    const auto check_snapshot = [&](const SegmentedSearchServer::Snapshot& snapshot, mt19937& reader_generator) {
+        const vector<int> document_ids = snapshot.GetDocumentIds();
+        Check(snapshot.GetDocumentCount() == static_cast<int>(document_ids.size()), "число документов снимка"s);
+        SearchServer model("and with"s);
+        for (const int document_id : document_ids) {
+            model.AddDocument(document_id, texts[document_id], statuses[document_id], {ratings[document_id]});
+        }
+        for (const string& query : queries) {
+            Check(AreSameDocuments(snapshot.FindTopDocuments(query), model.FindTopDocuments(query)), "поиск по снимку, запрос \""s + query + "\""s);
+        }
+        if (!document_ids.empty()) {
+            const int document_id = document_ids[reader_generator() % document_ids.size()];
+            const string& query = queries[reader_generator() % queries.size()];
+            Check(snapshot.MatchDocument(query, document_id) == model.MatchDocument(query, document_id),
+                  "MatchDocument по снимку, документ "s + to_string(document_id));
+        }
+    };
+    vector<future<void>> readers;
+    for (unsigned reader = 0; reader < 3; ++reader) {
+        readers.push_back(async(launch::async, [&, reader] {
+            mt19937 reader_generator(reader);
+            do {
+                check_snapshot(search_server.GetSnapshot(), reader_generator);
+            } while (is_writing);
+        }));
+    }
+    // Один читатель держит снимков больше, чем слотов в блоке эпох, пока остальные продолжают работать
+    readers.push_back(async(launch::async, [&] {
+        mt19937 reader_generator(100);
+        do {
+            vector<SegmentedSearchServer::Snapshot> snapshots;
+            for (int i = 0; i < 200; ++i) {
+                snapshots.push_back(search_server.GetSnapshot());
+            }
+            check_snapshot(snapshots.front(), reader_generator);
+            check_snapshot(snapshots.back(), reader_generator);
+        } while (is_writing);
+    }));
+    writer.get();
+    for (auto& reader : readers) {
+        reader.get();
+    }
+    search_server.MergeSegments();
+    mt19937 reader_generator(200);
+    check_snapshot(search_server.GetSnapshot(), reader_generator);
+}
+
+void TestSnapshotRoundTrip() {
+    auto make_server = [] {
+        mt19937 generator(7);
+        SearchServer search_server("and in on"s);
+        AddRandomDocuments(search_server, generator, 400);
+        return search_server;
+    };
+    const string path = (filesystem::temp_directory_path() / "search_server_test.snapshot"s).string();
+    make_server().SaveSnapshot(path);
+    mt19937 generator(8);
+
+    auto check_same = [&generator](const SearchServer& expected, const SearchServer& actual, const string& hint) {
+        Check(vector<int>(expected.begin(), expected.end()) == vector<int>(actual.begin(), actual.end()), hint + ": document ids"s);
+        Check(expected.FindDuplicates() == actual.FindDuplicates(), hint + ": duplicates"s);
+        for (const int document_id : expected) {
+            Check(expected.FindDuplicate(document_id) == actual.FindDuplicate(document_id), hint + ": duplicate of "s + to_string(document_id));
+        }
+        for (int i = 0; i < 20; ++i) {
+            const string query = MakeRandomQuery(generator);
+            Check(AreSameDocuments(expected.FindTopDocuments(query), actual.FindTopDocuments(query)), hint + ": "s + query);
+            Check(AreSameDocuments(expected.FindTopDocuments(query, DocumentStatus::BANNED), actual.FindTopDocuments(query, DocumentStatus::BANNED)),
+                  hint + ": banned "s + query);
+            for (const int document_id : expected) {
+                Check(expected.MatchDocument(query, document_id) == actual.MatchDocument(query, document_id), hint + ": match "s + query);
+            }
+        }
+    };
+
+    for (const SnapshotVerification verification : {SnapshotVerification::HEADER, SnapshotVerification::FULL}) {
+        SearchServer expected = make_server();
+        SearchServer loaded = SearchServer::LoadSnapshot(path, verification);
+        check_same(expected, loaded, "loaded"s);
+
+        // Первое изменение копирует отображённые таблицы, дальше загруженный сервер ведёт себя как обычный
+        for (SearchServer* server : {&expected, &loaded}) {
+            server->AddDocument(1000, "cat dog fish"s, DocumentStatus::ACTUAL, {5});
+            server->RemoveDocument(3);
+            server->UpdateDocumentStatus(10, DocumentStatus::BANNED);
+            server->UpdateDocumentRating(11, {-7});
+            server->UpdateDocument(12, "red big nose"s, DocumentStatus::ACTUAL, {1});
+        }
+        check_same(expected, loaded, "modified"s);
+    }
+
+    // Проверку контрольной суммы делает только полная верификация
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        file.seekg(0, ios::end);
+        const streamoff middle = file.tellg() / 2;
+        file.seekg(middle);
+        const char byte = static_cast<char>(file.get() ^ 0x5a);
+        file.seekp(middle);
+        file.put(byte);
+    }
+    bool rejected = false;
+    try {
+        SearchServer::LoadSnapshot(path, SnapshotVerification::FULL);
+    } catch (const runtime_error&) {
+        rejected = true;
+    }
+    Check(rejected, "corrupted snapshot is rejected"s);
+    remove(path.c_str());
+}
+
+void TestSearchServer() {
+    TestTermDictionaryChunks();
+    TestPreparedQueryFromAnotherServer();
+    TestLogLinearBuckets();
+    TestTopDocumentsOrder();
+    TestParallelSearchMatchesSequential();
+    TestCachedSearchMatchesUncached();
+    TestSearchPagesMatchFullRanking();
+    TestPagesAcrossRelevanceChain();
+    TestEpochDomainGrowsSlots();
+    TestSearchServerCopy();
+    TestImpactOrderedUpdates();
+    TestBatchRemovalMatchesSingleRemoval();
+    TestSegmentedWritesVisibleAfterSeal();
+    TestSegmentedSnapshotsMatchModel();
+    TestSnapshotRoundTrip();
+    cout << "Search server tests OK"s << endl;
+}
@@ -16,3 +16,21 @@ void AddDocument(SearchServer& search_server, int document_id, const std::string
 void FindTopDocuments(const SearchServer& search_server, const std::string& raw_query);
 
 void MatchDocuments(const SearchServer& search_server, const std::string& query);
+
+// Проверки поиска, которые запускает search-server --test. При первом расхождении бросают logic_error
+void TestTermDictionaryChunks();
+void TestPreparedQueryFromAnotherServer();
+void TestLogLinearBuckets();
+void TestTopDocumentsOrder();
+void TestParallelSearchMatchesSequential();
+void TestCachedSearchMatchesUncached();
+void TestSearchPagesMatchFullRanking();
+void TestPagesAcrossRelevanceChain();
+void TestEpochDomainGrowsSlots();
+void TestSearchServerCopy();
+void TestImpactOrderedUpdates();
+void TestBatchRemovalMatchesSingleRemoval();
+void TestSegmentedWritesVisibleAfterSeal();
+void TestSegmentedSnapshotsMatchModel();
+void TestSnapshotRoundTrip();
+void TestSearchServer();
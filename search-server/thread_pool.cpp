@@ -0,0 +1,146 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace {
+
+thread_local bool is_worker_thread = false;
+
+}
+
+ThreadPool::ThreadPool(size_t worker_count) {
+    worker_count = max<size_t>(1, worker_count);
+    for (size_t worker = 0; worker < worker_count; ++worker) {
+        queues_.push_back(make_unique<WorkerQueue>());
+    }
+    workers_.reserve(worker_count);
+    for (size_t worker = 0; worker < worker_count; ++worker) {
+        workers_.emplace_back([this, worker] {
+            RunWorker(worker);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    has_tasks_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const function<void(size_t)>& function) {
+    if (count == 0) {
+        return;
+    }
+    if (is_worker_thread || count == 1) {
+        for (size_t index = 0; index < count; ++index) {
+            function(index);
+        }
+        return;
+    }
+
+    Job job;
+    job.function = &function;
+    const size_t task_count = min(count, queues_.size() * tasks_per_worker_);
+    job.remaining_tasks = task_count;
+    {
+        lock_guard lock(mutex_);
+        for (size_t task = 0; task < task_count; ++task) {
+            WorkerQueue& queue = *queues_[next_queue_];
+            next_queue_ = (next_queue_ + 1) % queues_.size();
+            lock_guard queue_lock(queue.mutex);
+            queue.tasks.push_back({&job, count * task / task_count, count * (task + 1) / task_count});
+        }
+        queued_tasks_ += task_count;
+    }
+    has_tasks_.notify_all();
+
+    // Вызывающий поток не выполняет задачи сам, чтобы пул занимал ровно столько ядер, сколько в нём рабочих
+    unique_lock lock(job.mutex);
+    job.done.wait(lock, [&job] {
+        return job.remaining_tasks == 0;
+    });
+    if (job.exception) {
+        rethrow_exception(job.exception);
+    }
+}
+
+size_t ThreadPool::GetWorkerCount() const {
+    return workers_.size();
+}
+
+bool ThreadPool::IsWorkerThread() {
+    return is_worker_thread;
+}
+
+ThreadPool& ThreadPool::GetDefault() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::RunWorker(size_t worker) {
+    is_worker_thread = true;
+    while (true) {
+        if (TryRunTask(worker)) {
+            continue;
+        }
+        unique_lock lock(mutex_);
+        has_tasks_.wait(lock, [this] {
+            return stopping_ || queued_tasks_ > 0;
+        });
+        if (stopping_ && queued_tasks_ == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::TryRunTask(size_t worker) {
+    // Своя очередь разбирается с конца, а чужие с начала, чтобы владелец и похититель реже встречались на одной задаче
+    for (size_t offset = 0; offset < queues_.size(); ++offset) {
+        WorkerQueue& queue = *queues_[(worker + offset) % queues_.size()];
+        Task task;
+        {
+            lock_guard queue_lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            } else {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+        }
+        {
+            lock_guard lock(mutex_);
+            --queued_tasks_;
+        }
+        RunTask(task);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::RunTask(const Task& task) {
+    Job& job = *task.job;
+    exception_ptr exception;
+    try {
+        for (size_t index = task.first; index < task.last; ++index) {
+            (*job.function)(index);
+        }
+    } catch (...) {
+        exception = current_exception();
+    }
+    lock_guard lock(job.mutex);
+    if (exception && !job.exception) {
+        job.exception = exception;
+    }
+    if (--job.remaining_tasks == 0) {
+        job.done.notify_one();
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <execution>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Пул потоков с кражей задач: у каждого рабочего своя очередь, а освободившийся рабочий забирает задачи из чужих.
+// Вызов изнутри задачи любого пула выполняется последовательно, поэтому вложенный параллелизм не создаёт лишних потоков
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t worker_count = std::max(1u, std::thread::hardware_concurrency()));
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // Вызывает function(index) для каждого index из [0, count) и ждёт завершения всех вызовов.
+    // Первое выброшенное исключение передаётся вызывающему
+    void ParallelFor(size_t count, const std::function<void(size_t)>& function);
+
+    size_t GetWorkerCount() const;
+
+    static bool IsWorkerThread();
+    // Общий пул для функций, которым пул не передан явно
+    static ThreadPool& GetDefault();
+private:
+    static constexpr size_t tasks_per_worker_ = 4;
+
+    struct Job {
+        const std::function<void(size_t)>* function;
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining_tasks = 0;
+        std::exception_ptr exception;
+    };
+
+    struct Task {
+        Job* job;
+        size_t first;
+        size_t last;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    size_t queued_tasks_ = 0;
+    size_t next_queue_ = 0;
+    bool stopping_ = false;
+
+    void RunWorker(size_t worker);
+    bool TryRunTask(size_t worker);
+    static void RunTask(const Task& task);
+};
+
+// Политика выполнения для шаблонных методов SearchServer: параллельная часть выполняется в указанном пуле
+class ThreadPoolPolicy {
+public:
+    explicit ThreadPoolPolicy(ThreadPool& pool)
+        : pool_(&pool) {
+    }
+
+    ThreadPool& GetPool() const {
+        return *pool_;
+    }
+private:
+    ThreadPool* pool_;
+};
+
+template <typename ExecutionPolicy, typename Function>
+void ParallelFor(const ExecutionPolicy& policy, size_t count, Function function) {
+    if constexpr (std::is_same_v<ExecutionPolicy, ThreadPoolPolicy>) {
+        policy.GetPool().ParallelFor(count, function);
+    } else {
+        std::vector<size_t> indexes(count);
+        std::iota(indexes.begin(), indexes.end(), 0);
+        std::for_each(policy,
+                      indexes.begin(), indexes.end(),
+                      function);
+    }
+}
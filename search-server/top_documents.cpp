@@ -0,0 +1,74 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+TopDocuments::TopDocuments(size_t capacity)
+    : capacity_(capacity) {
+    heap_.reserve(capacity);
+}
+
+TopDocuments::TopDocuments(size_t capacity, vector<Document> storage)
+    : capacity_(capacity)
+    , heap_(move(storage)) {
+    heap_.clear();
+    heap_.reserve(capacity);
+}
+
+void TopDocuments::SetAfter(const Document& document) {
+    after_ = document;
+}
+
+void TopDocuments::Add(const Document& document) {
+    if (after_ && !IsMoreRelevant(*after_, document)) {
+        return;
+    }
+    if (heap_.size() < capacity_) {
+        heap_.push_back(document);
+        push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    } else if (capacity_ > 0 && IsMoreRelevant(document, heap_.front())) {
+        pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        heap_.back() = document;
+        push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+}
+
+void TopDocuments::Merge(const TopDocuments& other) {
+    for (const Document& document : other.heap_) {
+        Add(document);
+    }
+}
+
+size_t TopDocuments::GetCapacity() const {
+    return capacity_;
+}
+
+bool TopDocuments::IsFull() const {
+    return heap_.size() >= capacity_;
+}
+
+const Document& TopDocuments::GetWorst() const {
+    return heap_.front();
+}
+
+vector<Document> TopDocuments::Extract() {
+    sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return move(heap_);
+}
+
+bool TopDocuments::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    // Сравнивать релевантности с допуском нельзя: равенство с точностью до RELEVANCE_EPSILON не транзитивно, и цепочка
+    // документов с релевантностями через 0.7 * RELEVANCE_EPSILON и убывающими рейтингами зацикливала бы порядок кучи.
+    // Поэтому релевантность округляется до целого числа RELEVANCE_EPSILON, и документы сравниваются по этому ключу
+    const long long lhs_key = llround(lhs.relevance / RELEVANCE_EPSILON);
+    const long long rhs_key = llround(rhs.relevance / RELEVANCE_EPSILON);
+    if (lhs_key != rhs_key) {
+        return lhs_key > rhs_key;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
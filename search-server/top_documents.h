@@ -0,0 +1,34 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "document.h"
+
+const double RELEVANCE_EPSILON = 1e-6;
+
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t capacity);
+    // Память переданного вектора используется повторно, чтобы не выделять её на каждый запрос
+    TopDocuments(size_t capacity, std::vector<Document> storage);
+
+    // Документы, которые в порядке IsMoreRelevant не идут строго после document, отбрасываются
+    void SetAfter(const Document& document);
+    void Add(const Document& document);
+    void Merge(const TopDocuments& other);
+
+    size_t GetCapacity() const;
+    bool IsFull() const;
+    const Document& GetWorst() const;
+
+    std::vector<Document> Extract();
+
+    // Строгий полный порядок: релевантности, округлённые до целого числа RELEVANCE_EPSILON, по убыванию,
+    // при равных — рейтинг по убыванию, затем идентификатор по возрастанию
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+private:
+    size_t capacity_;
+    std::vector<Document> heap_;
+    std::optional<Document> after_;
+};